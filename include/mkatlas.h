@@ -0,0 +1,302 @@
+/*
+ * Reader of the binary metadata written by mkatlas --binary.
+ *
+ * The file is meant to be mapped (or read into memory) and used in place. Every table is an
+ * array of fixed size records which are 4 byte aligned, tables are located by their offset
+ * from the start of the file. Names are offsets into a table of zero terminated strings.
+ * Values are stored in the byte order of the machine which wrote the file, a file of the
+ * other byte order fails the version check.
+ *
+ * Images are found by name through a minimal perfect hash, names_buckets contains the
+ * displacement of every bucket and names_slots the index of the image in every slot.
+ *
+ * Kerning pairs of a font are sorted by the first and second character. They can also be
+ * hashed (mkatlas --kerninghash), the buckets of a font are in kerning_buckets and its slots
+ * are in kerning_slots at first_kerning. Slots contain indices relative to first_kerning.
+ *
+ * Glyphs are found by code in blocks of 256 characters. The pages of a font contain the
+ * index of the block + 1 and the blocks the index of the glyph + 1, zero if there is none.
+ * Indices are relative to the first block and glyph of the font.
+ *
+ *     const mkatlas_header* atlas = mkatlas_open(data, size);
+ *     const mkatlas_font* font = mkatlas_fonts(atlas);
+ *     const mkatlas_glyph* glyph = mkatlas_find_glyph(atlas, font, 'A');
+ */
+#ifndef MKATLAS_H
+#define MKATLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MKATLAS_VERSION 4
+
+/* Texture index of glyphs without an image (e.g. spaces) */
+#define MKATLAS_NONE 0xFFFFFFFFu
+
+/* Flags of mkatlas_header */
+#define MKATLAS_CHANNELS 1u /* glyphs are packed into the color channels of the textures */
+
+/* Flags of mkatlas_tile and mkatlas_glyph */
+#define MKATLAS_FLIPPED 1u /* rotated by 90 degrees */
+
+/* Displacements of the name and kerning hashes with this bit contain the slot */
+#define MKATLAS_DIRECT 0x80000000u
+
+/* Flags of mkatlas_font */
+#define MKATLAS_MSDF 1u /* glyphs are multi channel signed distant fields */
+
+typedef struct mkatlas_header {
+	char magic[4]; /* "MKAT" */
+	uint32_t version;
+	uint32_t flags;
+	uint32_t size; /* size of the file */
+	uint32_t num_textures, textures;
+	uint32_t num_images, images;
+	uint32_t num_tiles, tiles;
+	uint32_t num_fonts, fonts;
+	uint32_t num_glyphs, glyphs;
+	uint32_t num_kerning, kerning;
+	uint32_t strings_size, strings;
+	uint32_t num_pages, pages;
+	uint32_t num_blocks, blocks; /* number of entries, not blocks */
+	uint32_t names_seed;
+	uint32_t num_names_buckets, names_buckets;
+	uint32_t num_names_slots, names_slots;
+	uint32_t num_kerning_buckets, kerning_buckets;
+	uint32_t num_kerning_slots, kerning_slots; /* zero or num_kerning */
+	uint32_t reserved;
+} mkatlas_header;
+
+typedef struct mkatlas_texture {
+	uint32_t file; /* string */
+	uint32_t width;
+	uint32_t height;
+	uint32_t reserved;
+} mkatlas_texture;
+
+/* Images without tiles are transparent and aren't in a texture */
+typedef struct mkatlas_image {
+	uint32_t name; /* string */
+	uint32_t real_width, real_height;
+	uint32_t offset_x, offset_y, width, height; /* trimmed part of the image */
+	uint32_t columns, rows;
+	uint32_t first_tile, num_tiles;
+	uint32_t reserved;
+} mkatlas_image;
+
+typedef struct mkatlas_tile {
+	uint32_t texture;
+	uint32_t offset_x, offset_y; /* relative to the trimmed image */
+	uint32_t x, y, width, height;
+	uint32_t flags;
+} mkatlas_tile;
+
+typedef struct mkatlas_font {
+	uint32_t name; /* string */
+	uint32_t size;
+	uint32_t flags;
+	uint32_t first_glyph, num_glyphs;
+	uint32_t first_kerning, num_kerning;
+	uint32_t first_page, num_pages;
+	uint32_t first_block; /* entry of the first block */
+	uint32_t first_kerning_bucket, num_kerning_buckets; /* no buckets if the pairs aren't hashed */
+} mkatlas_font;
+
+typedef struct mkatlas_glyph {
+	uint32_t code;
+	uint32_t texture;
+	uint32_t channel;
+	uint32_t x, y, width, height;
+	uint32_t flags;
+	float adv_x, adv_y;
+	int32_t trans_x, trans_y;
+} mkatlas_glyph;
+
+typedef struct mkatlas_kerning {
+	uint32_t first, second;
+	float x;
+} mkatlas_kerning;
+
+static inline int mkatlas_check_table(uint32_t size, uint32_t count, uint32_t offset, uint32_t record) {
+	return offset % 4 == 0 && offset <= size && count <= (size - offset) / record;
+}
+
+/* Returns the header if data contains valid metadata, NULL otherwise */
+static inline const mkatlas_header* mkatlas_open(const void* data, size_t size) {
+	const mkatlas_header* h = (const mkatlas_header*) data;
+
+	if (size < sizeof(mkatlas_header) || ((uintptr_t) data) % 4 != 0)
+		return NULL;
+
+	if (memcmp(h->magic, "MKAT", 4) != 0 || h->version != MKATLAS_VERSION || h->size > size)
+		return NULL;
+
+	if (!mkatlas_check_table(h->size, h->num_textures, h->textures, sizeof(mkatlas_texture)) ||
+		!mkatlas_check_table(h->size, h->num_images, h->images, sizeof(mkatlas_image)) ||
+		!mkatlas_check_table(h->size, h->num_tiles, h->tiles, sizeof(mkatlas_tile)) ||
+		!mkatlas_check_table(h->size, h->num_fonts, h->fonts, sizeof(mkatlas_font)) ||
+		!mkatlas_check_table(h->size, h->num_glyphs, h->glyphs, sizeof(mkatlas_glyph)) ||
+		!mkatlas_check_table(h->size, h->num_kerning, h->kerning, sizeof(mkatlas_kerning)) ||
+		!mkatlas_check_table(h->size, h->num_pages, h->pages, sizeof(uint32_t)) ||
+		!mkatlas_check_table(h->size, h->num_blocks, h->blocks, sizeof(uint32_t)) ||
+		!mkatlas_check_table(h->size, h->num_names_buckets, h->names_buckets, sizeof(uint32_t)) ||
+		!mkatlas_check_table(h->size, h->num_names_slots, h->names_slots, sizeof(uint32_t)) ||
+		!mkatlas_check_table(h->size, h->num_kerning_buckets, h->kerning_buckets, sizeof(uint32_t)) ||
+		!mkatlas_check_table(h->size, h->num_kerning_slots, h->kerning_slots, sizeof(uint32_t)) ||
+		h->strings > h->size || h->strings_size == 0 || h->strings_size > h->size - h->strings)
+		return NULL;
+
+	/* Every string has to be terminated */
+	if (((const char*) data)[h->strings + h->strings_size - 1] != 0)
+		return NULL;
+
+	return h;
+}
+
+static inline const mkatlas_texture* mkatlas_textures(const mkatlas_header* h) {
+	return (const mkatlas_texture*) ((const char*) h + h->textures);
+}
+
+static inline const mkatlas_image* mkatlas_images(const mkatlas_header* h) {
+	return (const mkatlas_image*) ((const char*) h + h->images);
+}
+
+static inline const mkatlas_tile* mkatlas_tiles(const mkatlas_header* h) {
+	return (const mkatlas_tile*) ((const char*) h + h->tiles);
+}
+
+static inline const mkatlas_font* mkatlas_fonts(const mkatlas_header* h) {
+	return (const mkatlas_font*) ((const char*) h + h->fonts);
+}
+
+static inline const mkatlas_glyph* mkatlas_glyphs(const mkatlas_header* h) {
+	return (const mkatlas_glyph*) ((const char*) h + h->glyphs);
+}
+
+static inline const mkatlas_kerning* mkatlas_kernings(const mkatlas_header* h) {
+	return (const mkatlas_kerning*) ((const char*) h + h->kerning);
+}
+
+/* Returns an empty string if the offset is invalid */
+static inline const char* mkatlas_string(const mkatlas_header* h, uint32_t offset) {
+	return (const char*) h + h->strings + (offset < h->strings_size ? offset : h->strings_size - 1);
+}
+
+static inline uint64_t mkatlas_mix(uint64_t value) {
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDull;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+/* Returns NULL if there is no image with the name, the first image is returned if there are multiple */
+static inline const mkatlas_image* mkatlas_find_image(const mkatlas_header* h, const char* name) {
+	const uint32_t* buckets = (const uint32_t*) ((const char*) h + h->names_buckets);
+	const uint32_t* slots = (const uint32_t*) ((const char*) h + h->names_slots);
+	const mkatlas_image* image;
+	const unsigned char* chr;
+	uint64_t key = 14695981039346656037ull ^ h->names_seed;
+	uint32_t displacement, slot;
+
+	if (h->num_names_buckets == 0 || h->num_names_slots == 0)
+		return NULL;
+
+	for (chr = (const unsigned char*) name; *chr != 0; ++chr)
+		key = (key ^ *chr) * 1099511628211ull;
+
+	displacement = buckets[mkatlas_mix(key) % h->num_names_buckets];
+
+	if (displacement & MKATLAS_DIRECT)
+		slot = displacement & ~MKATLAS_DIRECT;
+	else
+		slot = (uint32_t) (mkatlas_mix(key + displacement * 0x9E3779B97F4A7C15ull) % h->num_names_slots);
+
+	if (slot >= h->num_names_slots || slots[slot] >= h->num_images)
+		return NULL;
+
+	image = &mkatlas_images(h)[slots[slot]];
+	return strcmp(mkatlas_string(h, image->name), name) == 0 ? image : NULL;
+}
+
+/* Returns NULL if the pair isn't kerned */
+static inline const mkatlas_kerning* mkatlas_find_kerning(const mkatlas_header* h, const mkatlas_font* font, uint32_t first, uint32_t second) {
+	const uint32_t* buckets = (const uint32_t*) ((const char*) h + h->kerning_buckets);
+	const uint32_t* slots = (const uint32_t*) ((const char*) h + h->kerning_slots);
+	const mkatlas_kerning* kerning;
+	uint64_t key = (uint64_t) first << 32 | second;
+	uint32_t displacement, slot, beg, end;
+
+	if (font->first_kerning > h->num_kerning || font->num_kerning > h->num_kerning - font->first_kerning || font->num_kerning == 0)
+		return NULL;
+
+	kerning = &mkatlas_kernings(h)[font->first_kerning];
+
+	/* Pairs which aren't hashed are searched */
+	if (font->num_kerning_buckets == 0) {
+		beg = 0;
+		end = font->num_kerning;
+
+		while (beg < end) {
+			slot = beg + (end - beg) / 2;
+
+			if (kerning[slot].first < first || (kerning[slot].first == first && kerning[slot].second < second))
+				beg = slot + 1;
+			else
+				end = slot;
+		}
+
+		return beg < font->num_kerning && kerning[beg].first == first && kerning[beg].second == second ? &kerning[beg] : NULL;
+	}
+
+	if (font->first_kerning_bucket > h->num_kerning_buckets || font->num_kerning_buckets > h->num_kerning_buckets - font->first_kerning_bucket ||
+		font->first_kerning + font->num_kerning > h->num_kerning_slots)
+		return NULL;
+
+	displacement = buckets[font->first_kerning_bucket + mkatlas_mix(key) % font->num_kerning_buckets];
+
+	if (displacement & MKATLAS_DIRECT)
+		slot = displacement & ~MKATLAS_DIRECT;
+	else
+		slot = (uint32_t) (mkatlas_mix(key + displacement * 0x9E3779B97F4A7C15ull) % font->num_kerning);
+
+	if (slot >= font->num_kerning || slots[font->first_kerning + slot] >= font->num_kerning)
+		return NULL;
+
+	kerning = &kerning[slots[font->first_kerning + slot]];
+	return kerning->first == first && kerning->second == second ? kerning : NULL;
+}
+
+/* Returns NULL if the font doesn't contain the character */
+static inline const mkatlas_glyph* mkatlas_find_glyph(const mkatlas_header* h, const mkatlas_font* font, uint32_t code) {
+	const uint32_t* pages = (const uint32_t*) ((const char*) h + h->pages);
+	const uint32_t* blocks = (const uint32_t*) ((const char*) h + h->blocks);
+	uint32_t block, glyph;
+
+	if (code / 256 >= font->num_pages || font->first_page > h->num_pages || font->num_pages > h->num_pages - font->first_page)
+		return NULL;
+
+	block = pages[font->first_page + code / 256];
+
+	if (block == 0 || font->first_block > h->num_blocks || (h->num_blocks - font->first_block) / 256 < block)
+		return NULL;
+
+	glyph = blocks[font->first_block + (block - 1) * 256 + code % 256];
+
+	if (glyph == 0 || glyph > font->num_glyphs || font->first_glyph > h->num_glyphs || glyph > h->num_glyphs - font->first_glyph)
+		return NULL;
+
+	return &mkatlas_glyphs(h)[font->first_glyph + glyph - 1];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
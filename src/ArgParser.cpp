@@ -9,16 +9,65 @@ inline void errArg(const char* arg) {
 	throw std::runtime_error(combine("invalid command line argument: ", arg));
 }
 
+// Parses a comma separated list of numbers
+inline std::vector<unsigned int> parseList(const char* arg) {
+	std::vector<unsigned int> values;
+
+	for (auto beg = arg;; ++beg) {
+		auto end = strchr(beg, ',');
+		values.push_back(std::stoul(end ? std::string(beg, end) : std::string(beg)));
+
+		if (!end)
+			break;
+
+		beg = end;
+	}
+
+	return values;
+}
+
+inline void parseSize(Options& opt, const char* arg) {
+	if (strcmp(arg, "auto") == 0)
+		opt.m_autoSize = true;
+	else
+		opt.m_height = opt.m_width = std::stoul(arg);
+}
+
 Options parseArguments(unsigned int argc, const char** argv) {
 	Options opt;
 
 #ifndef DISABLE_FREETYPE
 	FontOptions font;
+
+	// Fonts with multiple sizes are added once per size
+	std::vector<unsigned int> sizes;
+
+	auto addFont = [&opt, &font, &sizes]() {
+		if (sizes.empty())
+			opt.m_fonts.push_back(font);
+
+		for (auto size : sizes) {
+			font.m_size = size;
+			opt.m_fonts.push_back(font);
+		}
+	};
 #endif
 
 	for (unsigned int i = 0; i < argc; ++i) {
 		if (strncmp(argv[i], "--", 2) == 0) {
-			if (strcmp(argv[i] + 2, "expand") == 0) {
+			if (strcmp(argv[i] + 2, "align") == 0) {
+				if (++i >= argc)
+					errArg(argv[i - 1]);
+
+				opt.m_align = std::stoul(argv[i]);
+			}
+			else if (strcmp(argv[i] + 2, "binary") == 0)
+				opt.m_binary = true;
+			else if (strcmp(argv[i] + 2, "channels") == 0)
+				opt.m_channels = true;
+			else if (strcmp(argv[i] + 2, "compact") == 0)
+				opt.m_compact = true;
+			else if (strcmp(argv[i] + 2, "expand") == 0) {
 				opt.m_expand = true;
 			}
 			else if (strcmp(argv[i] + 2, "folder") == 0) {
@@ -27,6 +76,14 @@ Options parseArguments(unsigned int argc, const char** argv) {
 
 				opt.m_outputFolder = argv[i];
 			}
+			else if (strcmp(argv[i] + 2, "gray") == 0)
+				opt.m_gray = true;
+			else if (strcmp(argv[i] + 2, "header") == 0) {
+				if (++i >= argc)
+					errArg(argv[i - 1]);
+
+				opt.m_header = argv[i];
+			}
 			else if (strcmp(argv[i] + 2, "height") == 0) {
 				if (++i >= argc)
 					errArg(argv[i - 1]);
@@ -35,12 +92,26 @@ Options parseArguments(unsigned int argc, const char** argv) {
 			}
 			else if (strcmp(argv[i] + 2, "help") == 0)
 				opt.m_help = true;
+			else if (strcmp(argv[i] + 2, "incremental") == 0)
+				opt.m_incremental = true;
 			else if (strcmp(argv[i] + 2, "maxtextures") == 0) {
 				if (++i >= argc)
 					errArg(argv[i - 1]);
 
 				opt.m_maxTextures = std::stoul(argv[i]);
 			}
+			else if (strcmp(argv[i] + 2, "maxsize") == 0) {
+				if (++i >= argc)
+					errArg(argv[i - 1]);
+
+				opt.m_maxSize = std::stoul(argv[i]);
+			}
+			else if (strcmp(argv[i] + 2, "memorybudget") == 0) {
+				if (++i >= argc)
+					errArg(argv[i - 1]);
+
+				opt.m_memoryBudget = std::stoul(argv[i]);
+			}
 			else if (strcmp(argv[i] + 2, "noflip") == 0)
 				opt.m_noFlip = true;
 			else if (strcmp(argv[i] + 2, "out") == 0) {
@@ -55,11 +126,23 @@ Options parseArguments(unsigned int argc, const char** argv) {
 
 				opt.m_padding = std::stoul(argv[i]);
 			}
+			else if (strcmp(argv[i] + 2, "pot") == 0)
+				opt.m_powerOfTwo = true;
+			else if (strcmp(argv[i] + 2, "serve") == 0)
+				opt.m_serve = true;
+			else if (strcmp(argv[i] + 2, "shrink") == 0)
+				opt.m_shrink = true;
 			else if (strcmp(argv[i] + 2, "size") == 0) {
 				if (++i >= argc)
 					errArg(argv[i - 1]);
 
-				opt.m_height = opt.m_width = std::stoul(argv[i]);
+				parseSize(opt, argv[i]);
+			}
+			else if (strcmp(argv[i] + 2, "threads") == 0) {
+				if (++i >= argc)
+					errArg(argv[i - 1]);
+
+				opt.m_threads = std::stoul(argv[i]);
 			}
 			else if (strcmp(argv[i] + 2, "trim") == 0)
 				opt.m_trim = true;
@@ -73,6 +156,12 @@ Options parseArguments(unsigned int argc, const char** argv) {
 			}
 
 		#ifndef DISABLE_FREETYPE
+			else if (strcmp(argv[i] + 2, "cache") == 0) {
+				if (++i >= argc)
+					errArg(argv[i - 1]);
+
+				opt.m_glyphCache = argv[i];
+			}
 			else if (strcmp(argv[i] + 2, "color") == 0) {
 				if (++i >= argc)
 					errArg(argv[i - 1]);
@@ -96,9 +185,10 @@ Options parseArguments(unsigned int argc, const char** argv) {
 					errArg(argv[i - 1]);
 
 				if (!font.m_file.empty() && !font.m_ranges.empty())
-					opt.m_fonts.push_back(font);
+					addFont();
 
 				font = FontOptions();
+				sizes.clear();
 
 				font.m_file = argv[i];
 			}
@@ -106,8 +196,14 @@ Options parseArguments(unsigned int argc, const char** argv) {
 				if (++i >= argc)
 					errArg(argv[i - 1]);
 
-				font.m_size = std::stoul(argv[i]);
+				sizes = parseList(argv[i]);
 			}
+			else if (strcmp(argv[i] + 2, "kerning") == 0)
+				font.m_kerning = true;
+			else if (strcmp(argv[i] + 2, "kerninghash") == 0)
+				opt.m_kerningHash = true;
+			else if (strcmp(argv[i] + 2, "msdf") == 0)
+				font.m_multiChannel = true;
 			else if (strcmp(argv[i] + 2, "name") == 0) {
 				if (++i >= argc)
 					errArg(argv[i - 1]);
@@ -155,7 +251,7 @@ Options parseArguments(unsigned int argc, const char** argv) {
 					if (++i >= argc)
 						errArg(argv[i - 1]);
 
-					opt.m_height = opt.m_width = std::stoul(argv[i]);
+					parseSize(opt, argv[i]);
 					break;
 				case 't':
 				case 'T':
@@ -179,9 +275,10 @@ Options parseArguments(unsigned int argc, const char** argv) {
 						errArg(argv[i - 1]);
 
 					if (!font.m_file.empty() && !font.m_ranges.empty())
-						opt.m_fonts.push_back(font);
+						addFont();
 
 					font = FontOptions();
+					sizes.clear();
 
 					font.m_file = argv[i];
 					break;
@@ -190,7 +287,7 @@ Options parseArguments(unsigned int argc, const char** argv) {
 					if (++i >= argc)
 						errArg(argv[i - 1]);
 
-					font.m_size = std::stoul(argv[i]);
+					sizes = parseList(argv[i]);
 					break;
 				case 'n':
 				case 'N':
@@ -222,17 +319,23 @@ Options parseArguments(unsigned int argc, const char** argv) {
 
 #ifndef DISABLE_FREETYPE
 	if (!font.m_file.empty())
-		opt.m_fonts.push_back(font);
+		addFont();
 
-	// Combine and sort ranges
+	// Combine and sort ranges, reversed ranges are turned around
 	for (auto& font : opt.m_fonts) {
-		std::sort(font.m_ranges.begin(), font.m_ranges.end(), [](auto a, auto b) { return a.m_beg - b.m_beg; });
+		for (auto& range : font.m_ranges)
+			if (range.m_beg > range.m_end)
+				std::swap(range.m_beg, range.m_end);
 
-		for (unsigned int i = 0; !font.m_ranges.empty() && i < font.m_ranges.size() - 1; ++i) {
+		std::sort(font.m_ranges.begin(), font.m_ranges.end(), [](auto a, auto b) { return a.m_beg < b.m_beg; });
+
+		for (unsigned int i = 0; i + 1 < font.m_ranges.size();) {
 			if (font.m_ranges[i].isIntersecting(font.m_ranges[i + 1])) {
 				font.m_ranges[i] = font.m_ranges[i].join(font.m_ranges[i + 1]);
 				font.m_ranges.erase(font.m_ranges.begin() + (i + 1));
 			}
+			else
+				++i;
 		}
 	}
 #endif
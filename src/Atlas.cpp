@@ -0,0 +1,880 @@
+// Disable warnings for fopen
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "Atlas.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "JSONWriter.hpp"
+#include "PerfectHash.hpp"
+#include "Utils.hpp"
+#include "mkatlas.h"
+
+// Characters are looked up in blocks of 256, pages contain the index of the block + 1 and blocks the index of
+// the glyph + 1 (zero if there is none). Blocks are only added for pages which contain characters.
+struct PageTable {
+	std::vector<unsigned int> m_pages;
+	std::vector<unsigned int> m_blocks;
+};
+
+static PageTable buildPageTable(const AtlasFont& font) {
+	PageTable table;
+
+	for (unsigned int i = 0; i < font.m_glyphs.size(); ++i) {
+		auto page = font.m_glyphs[i].m_code / 256;
+
+		if (page >= table.m_pages.size())
+			table.m_pages.resize(page + 1, 0);
+
+		if (table.m_pages[page] == 0) {
+			table.m_blocks.resize(table.m_blocks.size() + 256, 0);
+			table.m_pages[page] = (unsigned int) (table.m_blocks.size() / 256);
+		}
+
+		table.m_blocks[(table.m_pages[page] - 1) * 256 + font.m_glyphs[i].m_code % 256] = i + 1;
+	}
+
+	return table;
+}
+
+void saveJSON(const Atlas& atlas, const std::string& file, bool compact) {
+	JSONWriter writer(compact);
+
+	writer.begin();
+
+	writer.key("textures");
+	writer.beginArray();
+
+	for (auto& texture : atlas.m_textures) {
+		writer.begin();
+
+		writer.key("file");
+		writer.writeString(texture.m_file);
+
+		writer.key("width");
+		writer.writeUint(texture.m_width);
+
+		writer.key("height");
+		writer.writeUint(texture.m_height);
+
+		writer.end();
+	}
+
+	writer.end();
+
+	if (!atlas.m_images.empty()) {
+		writer.key("images");
+		writer.beginArray();
+
+		for (auto& image : atlas.m_images) {
+			writer.begin();
+
+			auto& bounds = image.m_bounds;
+
+			if (!image.m_tiles.empty()) {
+				auto& tiles = image.m_tiles;
+
+				if (tiles.size() == 1) {
+					writer.key("texture");
+					writer.writeUint(tiles[0].m_texture);
+				}
+
+				writer.key("name");
+				writer.writeString(image.m_name);
+
+				if (bounds.m_x != 0 || bounds.m_y != 0 || bounds.m_w != image.m_realWidth || bounds.m_h != image.m_realHeight) {
+					writer.key("offsetX");
+					writer.writeUint(bounds.m_x);
+
+					writer.key("offsetY");
+					writer.writeUint(bounds.m_y);
+
+					writer.key("realWidth");
+					writer.writeUint(image.m_realWidth);
+
+					writer.key("realHeight");
+					writer.writeUint(image.m_realHeight);
+				}
+
+				if (tiles.size() == 1) {
+					writer.key("x");
+					writer.writeUint(tiles[0].m_x);
+
+					writer.key("y");
+					writer.writeUint(tiles[0].m_y);
+				}
+
+				writer.key("width");
+				writer.writeUint(bounds.m_w);
+
+				writer.key("height");
+				writer.writeUint(bounds.m_h);
+
+				if (tiles.size() == 1) {
+					if (atlas.m_canFlip) {
+						writer.key("flipped");
+						writer.writeBool(tiles[0].m_flipped);
+					}
+				}
+				else {
+					// Image is split into tiles, offsets are relative to the (trimmed) image
+					writer.key("columns");
+					writer.writeUint(image.m_columns);
+
+					writer.key("rows");
+					writer.writeUint(image.m_rows);
+
+					writer.key("tiles");
+					writer.beginArray();
+
+					for (auto& tile : tiles) {
+						writer.begin();
+
+						writer.key("texture");
+						writer.writeUint(tile.m_texture);
+
+						writer.key("offsetX");
+						writer.writeUint(tile.m_offsetX);
+
+						writer.key("offsetY");
+						writer.writeUint(tile.m_offsetY);
+
+						writer.key("x");
+						writer.writeUint(tile.m_x);
+
+						writer.key("y");
+						writer.writeUint(tile.m_y);
+
+						writer.key("width");
+						writer.writeUint(tile.m_width);
+
+						writer.key("height");
+						writer.writeUint(tile.m_height);
+
+						if (atlas.m_canFlip) {
+							writer.key("flipped");
+							writer.writeBool(tile.m_flipped);
+						}
+
+						writer.end();
+					}
+
+					writer.end();
+				}
+			}
+			else {
+				writer.key("name");
+				writer.writeString(image.m_name);
+
+				writer.key("realWidth");
+				writer.writeUint(image.m_realWidth);
+
+				writer.key("realHeight");
+				writer.writeUint(image.m_realHeight);
+			}
+
+			writer.end();
+		}
+
+		writer.end();
+	}
+
+	if (!atlas.m_fonts.empty()) {
+		writer.key("fonts");
+		writer.beginArray();
+
+		for (auto& font : atlas.m_fonts) {
+			writer.begin();
+
+			writer.key("name");
+			writer.writeString(font.m_name);
+
+			writer.key("size");
+			writer.writeUint(font.m_size);
+
+			if (font.m_multiChannel) {
+				writer.key("msdf");
+				writer.writeBool(true);
+			}
+
+			if (!font.m_glyphs.empty()) {
+				writer.key("glyphs");
+				writer.beginArray();
+
+				for (auto& glyph : font.m_glyphs) {
+					writer.begin();
+
+					if (glyph.m_hasTexture) {
+						writer.key("texture");
+						writer.writeUint(glyph.m_texture);
+
+						if (atlas.m_channels) {
+							writer.key("channel");
+							writer.writeUint(glyph.m_channel);
+						}
+
+						writer.key("code");
+						writer.writeUint(glyph.m_code);
+
+						writer.key("x");
+						writer.writeUint(glyph.m_x);
+
+						writer.key("y");
+						writer.writeUint(glyph.m_y);
+
+						writer.key("width");
+						writer.writeUint(glyph.m_width);
+
+						writer.key("height");
+						writer.writeUint(glyph.m_height);
+
+						if (atlas.m_canFlip) {
+							writer.key("flipped");
+							writer.writeBool(glyph.m_flipped);
+						}
+
+						writer.key("advX");
+						writer.writeDouble(glyph.m_advX);
+
+						writer.key("advY");
+						writer.writeDouble(glyph.m_advY);
+
+						writer.key("transX");
+						writer.writeInt(glyph.m_transX);
+
+						writer.key("transY");
+						writer.writeInt(glyph.m_transY);
+					}
+					else {
+						writer.key("code");
+						writer.writeUint(glyph.m_code);
+
+						writer.key("advX");
+						writer.writeDouble(glyph.m_advX);
+
+						writer.key("advY");
+						writer.writeDouble(glyph.m_advY);
+					}
+
+					writer.end();
+				}
+
+				writer.end();
+
+				// Index of the characters
+				auto table = buildPageTable(font);
+
+				writer.key("pages");
+				writer.beginArray();
+
+				for (auto page : table.m_pages)
+					writer.writeUint(page);
+
+				writer.end();
+
+				writer.key("blocks");
+				writer.beginArray();
+
+				for (auto block : table.m_blocks)
+					writer.writeUint(block);
+
+				writer.end();
+			}
+
+			if (!font.m_kerning.empty()) {
+				writer.key("kerning");
+				writer.beginArray();
+
+				for (auto& kerning : font.m_kerning) {
+					writer.begin();
+
+					writer.key("first");
+					writer.writeUint(kerning.m_first);
+
+					writer.key("second");
+					writer.writeUint(kerning.m_second);
+
+					writer.key("x");
+					writer.writeDouble(kerning.m_x);
+
+					writer.end();
+				}
+
+				writer.end();
+			}
+
+			writer.end();
+		}
+
+		writer.end();
+	}
+
+	writer.end();
+
+	auto f = finalize(fopen(file.c_str(), "wb"), fclose);
+
+	if (!f)
+		throw std::runtime_error(combine("failed to open file (\"", file, "\")"));
+
+	auto& data = writer.data();
+
+	if (fwrite(data.data(), 1, data.size(), f.get()) != data.size() || fputc('\n', f.get()) == EOF)
+		throw std::runtime_error(combine("failed to write file (\"", file, "\")"));
+}
+
+// Equal strings are stored once
+class StringTable {
+public:
+	unsigned int add(const std::string& str) {
+		auto it = m_offsets.emplace(str, (unsigned int) m_data.size());
+
+		if (it.second)
+			m_data.insert(m_data.end(), str.c_str(), str.c_str() + str.size() + 1);
+
+		return it.first->second;
+	}
+
+	const std::vector<char>& data() const {
+		return m_data;
+	}
+
+private:
+	std::vector<char> m_data;
+	std::unordered_map<std::string, unsigned int> m_offsets;
+};
+
+// Tables start at a multiple of 4 bytes
+static unsigned int alignOffset(unsigned long long offset) {
+	offset = (offset + 3) & ~3ull;
+
+	if (offset > 0xFFFFFFFFull)
+		throw std::runtime_error("metadata is too large for binary format");
+
+	return (unsigned int) offset;
+}
+
+// Hash of the kerning pairs of a font, the slots contain the index of the pair
+static PerfectHash hashKerning(const AtlasFont& font) {
+	std::vector<unsigned long long> keys;
+	keys.reserve(font.m_kerning.size());
+
+	for (auto& pair : font.m_kerning)
+		keys.push_back(perfectHashKey(pair.m_first, pair.m_second));
+
+	return buildPerfectHash(keys);
+}
+
+void saveBinary(const Atlas& atlas, const std::string& file, bool kerningHash) {
+	static_assert(sizeof(mkatlas_header) == 128 && sizeof(mkatlas_texture) == 16 && sizeof(mkatlas_image) == 48 &&
+		sizeof(mkatlas_tile) == 32 && sizeof(mkatlas_font) == 48 && sizeof(mkatlas_glyph) == 48 &&
+		sizeof(mkatlas_kerning) == 12, "unexpected size of binary records");
+
+	StringTable strings;
+	strings.add("");
+
+	std::vector<mkatlas_texture> textures;
+	textures.reserve(atlas.m_textures.size());
+
+	for (auto& texture : atlas.m_textures)
+		textures.push_back({ strings.add(texture.m_file), texture.m_width, texture.m_height, 0 });
+
+	std::vector<mkatlas_image> images;
+	std::vector<mkatlas_tile> tiles;
+	images.reserve(atlas.m_images.size());
+
+	for (auto& image : atlas.m_images) {
+		images.push_back({
+			strings.add(image.m_name), image.m_realWidth, image.m_realHeight,
+			image.m_bounds.m_x, image.m_bounds.m_y, image.m_bounds.m_w, image.m_bounds.m_h,
+			image.m_columns, image.m_rows, (unsigned int) tiles.size(), (unsigned int) image.m_tiles.size(), 0
+		});
+
+		for (auto& tile : image.m_tiles)
+			tiles.push_back({
+				tile.m_texture, tile.m_offsetX, tile.m_offsetY, tile.m_x, tile.m_y, tile.m_width, tile.m_height,
+				tile.m_flipped ? MKATLAS_FLIPPED : 0
+			});
+	}
+
+	std::vector<mkatlas_font> fonts;
+	std::vector<mkatlas_glyph> glyphs;
+	std::vector<mkatlas_kerning> kerning;
+	std::vector<uint32_t> pages;
+	std::vector<uint32_t> blocks;
+	std::vector<uint32_t> kerningBuckets;
+	std::vector<uint32_t> kerningSlots;
+	fonts.reserve(atlas.m_fonts.size());
+
+	for (auto& font : atlas.m_fonts) {
+		auto table = buildPageTable(font);
+		PerfectHash pairs;
+
+		if (kerningHash)
+			pairs = hashKerning(font);
+
+		fonts.push_back({
+			strings.add(font.m_name), font.m_size, font.m_multiChannel ? MKATLAS_MSDF : 0,
+			(unsigned int) glyphs.size(), (unsigned int) font.m_glyphs.size(),
+			(unsigned int) kerning.size(), (unsigned int) font.m_kerning.size(),
+			(unsigned int) pages.size(), (unsigned int) table.m_pages.size(), (unsigned int) blocks.size(),
+			(unsigned int) kerningBuckets.size(), (unsigned int) pairs.m_displacements.size()
+		});
+
+		kerningBuckets.insert(kerningBuckets.end(), pairs.m_displacements.begin(), pairs.m_displacements.end());
+		kerningSlots.insert(kerningSlots.end(), pairs.m_slots.begin(), pairs.m_slots.end());
+
+		pages.insert(pages.end(), table.m_pages.begin(), table.m_pages.end());
+		blocks.insert(blocks.end(), table.m_blocks.begin(), table.m_blocks.end());
+
+		for (auto& glyph : font.m_glyphs)
+			glyphs.push_back({
+				glyph.m_code, glyph.m_hasTexture ? glyph.m_texture : MKATLAS_NONE, glyph.m_channel,
+				glyph.m_x, glyph.m_y, glyph.m_width, glyph.m_height, glyph.m_flipped ? MKATLAS_FLIPPED : 0,
+				glyph.m_advX, glyph.m_advY, glyph.m_transX, glyph.m_transY
+			});
+
+		for (auto& pair : font.m_kerning)
+			kerning.push_back({ pair.m_first, pair.m_second, pair.m_x });
+	}
+
+	std::vector<std::string> names;
+	names.reserve(atlas.m_images.size());
+
+	for (auto& image : atlas.m_images)
+		names.push_back(image.m_name);
+
+	auto hash = buildPerfectHash(names);
+
+	mkatlas_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "MKAT", 4);
+	header.version = MKATLAS_VERSION;
+	header.flags = atlas.m_channels ? MKATLAS_CHANNELS : 0;
+	header.names_seed = hash.m_seed;
+
+	unsigned long long offset = sizeof(header);
+
+	auto place = [&offset](uint32_t& count, uint32_t& start, std::size_t num, std::size_t size) {
+		count = (uint32_t) num;
+		start = alignOffset(offset);
+		offset = start + (unsigned long long) num * size;
+	};
+
+	place(header.num_textures, header.textures, textures.size(), sizeof(mkatlas_texture));
+	place(header.num_images, header.images, images.size(), sizeof(mkatlas_image));
+	place(header.num_tiles, header.tiles, tiles.size(), sizeof(mkatlas_tile));
+	place(header.num_fonts, header.fonts, fonts.size(), sizeof(mkatlas_font));
+	place(header.num_glyphs, header.glyphs, glyphs.size(), sizeof(mkatlas_glyph));
+	place(header.num_kerning, header.kerning, kerning.size(), sizeof(mkatlas_kerning));
+	place(header.num_pages, header.pages, pages.size(), sizeof(uint32_t));
+	place(header.num_blocks, header.blocks, blocks.size(), sizeof(uint32_t));
+	place(header.num_names_buckets, header.names_buckets, hash.m_displacements.size(), sizeof(uint32_t));
+	place(header.num_names_slots, header.names_slots, hash.m_slots.size(), sizeof(uint32_t));
+	place(header.num_kerning_buckets, header.kerning_buckets, kerningBuckets.size(), sizeof(uint32_t));
+	place(header.num_kerning_slots, header.kerning_slots, kerningSlots.size(), sizeof(uint32_t));
+	place(header.strings_size, header.strings, strings.data().size(), 1);
+	header.size = alignOffset(offset);
+
+	auto f = finalize(fopen(file.c_str(), "wb"), fclose);
+
+	if (!f)
+		throw std::runtime_error(combine("failed to open file (\"", file, "\")"));
+
+	unsigned long long written = 0;
+
+	auto write = [&f, &written](unsigned int start, const void* data, std::size_t size) {
+		static const char padding[4] = { };
+		fwrite(padding, 1, (std::size_t) (start - written), f.get());
+		fwrite(data, 1, size, f.get());
+		written = start + (unsigned long long) size;
+	};
+
+	write(0, &header, sizeof(header));
+	write(header.textures, textures.data(), textures.size() * sizeof(mkatlas_texture));
+	write(header.images, images.data(), images.size() * sizeof(mkatlas_image));
+	write(header.tiles, tiles.data(), tiles.size() * sizeof(mkatlas_tile));
+	write(header.fonts, fonts.data(), fonts.size() * sizeof(mkatlas_font));
+	write(header.glyphs, glyphs.data(), glyphs.size() * sizeof(mkatlas_glyph));
+	write(header.kerning, kerning.data(), kerning.size() * sizeof(mkatlas_kerning));
+	write(header.pages, pages.data(), pages.size() * sizeof(uint32_t));
+	write(header.blocks, blocks.data(), blocks.size() * sizeof(uint32_t));
+	write(header.names_buckets, hash.m_displacements.data(), hash.m_displacements.size() * sizeof(uint32_t));
+	write(header.names_slots, hash.m_slots.data(), hash.m_slots.size() * sizeof(uint32_t));
+	write(header.kerning_buckets, kerningBuckets.data(), kerningBuckets.size() * sizeof(uint32_t));
+	write(header.kerning_slots, kerningSlots.data(), kerningSlots.size() * sizeof(uint32_t));
+	write(header.strings, strings.data().data(), strings.data().size());
+	write(header.size, nullptr, 0);
+
+	if (ferror(f.get()))
+		throw std::runtime_error(combine("failed to write file (\"", file, "\")"));
+}
+
+static const char* cppKeywords[] = {
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+	"char", "char16_t", "char32_t", "class", "compl", "const", "const_cast", "constexpr", "continue", "decltype",
+	"default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false",
+	"float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+	"not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+	"reinterpret_cast", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+	"switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+	"unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"
+};
+
+// Turns names into unique identifiers, invalid characters are replaced by underscores
+class Identifiers {
+public:
+	std::string add(const std::string& name) {
+		std::string id;
+
+		for (auto chr : name)
+			id += isalnum((unsigned char) chr) || chr == '_' ? chr : '_';
+
+		if (id.empty() || isdigit((unsigned char) id[0]))
+			id = '_' + id;
+
+		for (auto keyword : cppKeywords)
+			if (id == keyword)
+				id += '_';
+
+		auto unique = id;
+
+		for (unsigned int i = 2; !m_used.insert(unique).second; ++i)
+			unique = id + '_' + std::to_string(i);
+
+		return unique;
+	}
+
+private:
+	std::unordered_set<std::string> m_used;
+};
+
+static std::string cppString(const std::string& str) {
+	std::string res = "\"";
+
+	for (auto chr : str) {
+		auto value = (unsigned char) chr;
+
+		// Octal escapes can't run into following characters
+		if (value < 0x20 || value >= 0x7F || chr == '"' || chr == '\\' || chr == '?') {
+			char escape[5];
+			snprintf(escape, sizeof(escape), "\\%03o", value);
+			res += escape;
+		}
+		else
+			res += chr;
+	}
+
+	return res + '"';
+}
+
+static std::string cppFloat(float value) {
+	char str[32];
+	snprintf(str, sizeof(str), "%.9g", value);
+
+	std::string res = str;
+
+	if (res.find_first_of(".e") == std::string::npos)
+		res += ".0";
+
+	return res + 'f';
+}
+
+// Arrays can't be empty, so a value initialized element is written instead
+static void cppArray(std::ostream& out, const char* type, const std::string& name, std::size_t count, const std::function<void(std::size_t)>& write) {
+	out << "constexpr " << type << ' ' << name << "[] = {\n";
+
+	for (std::size_t i = 0; i < count; ++i) {
+		out << '\t';
+		write(i);
+		out << ",\n";
+	}
+
+	if (count == 0)
+		out << "\t{ }\n";
+
+	out << "};\n\n";
+}
+
+void saveHeader(const Atlas& atlas, const std::string& file, bool kerningHash) {
+	std::ostringstream out;
+
+	out <<
+		"// Generated by mkatlas, don't edit\n"
+		"#pragma once\n"
+		"\n"
+		"namespace atlas {\n"
+		"\n"
+		"struct Texture {\n"
+		"\tconst char* file;\n"
+		"\tunsigned int width;\n"
+		"\tunsigned int height;\n"
+		"};\n"
+		"\n"
+		"// Part of an image in a texture, the offset is relative to the trimmed image\n"
+		"struct Tile {\n"
+		"\tunsigned int texture;\n"
+		"\tunsigned int offsetX, offsetY;\n"
+		"\tunsigned int x, y, width, height;\n"
+		"\tbool flipped;\n"
+		"};\n"
+		"\n"
+		"// Transparent images have no tiles\n"
+		"struct Image {\n"
+		"\tconst char* name;\n"
+		"\tunsigned int realWidth, realHeight;\n"
+		"\tunsigned int offsetX, offsetY, width, height;\n"
+		"\tunsigned int columns, rows;\n"
+		"\tunsigned int firstTile, numTiles;\n"
+		"};\n"
+		"\n"
+		"// Glyphs without image have texture -1\n"
+		"struct Glyph {\n"
+		"\tunsigned int code;\n"
+		"\tint texture;\n"
+		"\tunsigned int channel;\n"
+		"\tunsigned int x, y, width, height;\n"
+		"\tbool flipped;\n"
+		"\tfloat advX, advY;\n"
+		"\tint transX, transY;\n"
+		"};\n"
+		"\n"
+		"struct Kerning {\n"
+		"\tunsigned int first, second;\n"
+		"\tfloat x;\n"
+		"};\n"
+		"\n"
+		"// Characters are looked up in blocks of 256, pages contain the index of the block + 1 (or 0)\n"
+		"// and blocks the index of the glyph + 1 (or 0). Kerning pairs are sorted and can also be hashed.\n"
+		"struct Font {\n"
+		"\tconst char* name;\n"
+		"\tunsigned int size;\n"
+		"\tbool msdf;\n"
+		"\tconst Glyph* glyphs;\n"
+		"\tunsigned int numGlyphs;\n"
+		"\tconst unsigned int* pages;\n"
+		"\tunsigned int numPages;\n"
+		"\tconst unsigned int* blocks;\n"
+		"\tconst Kerning* kerning;\n"
+		"\tunsigned int numKerning;\n"
+		"\tconst unsigned int* kerningBuckets;\n"
+		"\tunsigned int numKerningBuckets;\n"
+		"\tconst unsigned int* kerningSlots;\n"
+		"};\n"
+		"\n";
+
+	out << "constexpr bool channels = " << (atlas.m_channels ? "true" : "false") << ";\n\n";
+
+	out << "constexpr unsigned int numTextures = " << atlas.m_textures.size() << ";\n\n";
+
+	cppArray(out, "Texture", "textures", atlas.m_textures.size(), [&](std::size_t i) {
+		auto& texture = atlas.m_textures[i];
+		out << "{ " << cppString(texture.m_file) << ", " << texture.m_width << ", " << texture.m_height << " }";
+	});
+
+	// Images
+	Identifiers imageIds;
+	out << "enum class ImageId : unsigned int {\n";
+
+	for (auto& image : atlas.m_images)
+		out << '\t' << imageIds.add(image.m_name) << ",\n";
+
+	out << "};\n\n";
+
+	out << "constexpr unsigned int numImages = " << atlas.m_images.size() << ";\n\n";
+
+	std::vector<const AtlasTile*> tiles;
+	std::vector<unsigned int> firstTiles;
+
+	for (auto& image : atlas.m_images) {
+		firstTiles.push_back((unsigned int) tiles.size());
+
+		for (auto& tile : image.m_tiles)
+			tiles.push_back(&tile);
+	}
+
+	cppArray(out, "Tile", "tiles", tiles.size(), [&](std::size_t i) {
+		auto& tile = *tiles[i];
+		out << "{ " << tile.m_texture << ", " << tile.m_offsetX << ", " << tile.m_offsetY << ", " << tile.m_x << ", " << tile.m_y << ", "
+			<< tile.m_width << ", " << tile.m_height << ", " << (tile.m_flipped ? "true" : "false") << " }";
+	});
+
+	cppArray(out, "Image", "images", atlas.m_images.size(), [&](std::size_t i) {
+		auto& image = atlas.m_images[i];
+		out << "{ " << cppString(image.m_name) << ", " << image.m_realWidth << ", " << image.m_realHeight << ", "
+			<< image.m_bounds.m_x << ", " << image.m_bounds.m_y << ", " << image.m_bounds.m_w << ", " << image.m_bounds.m_h << ", "
+			<< image.m_columns << ", " << image.m_rows << ", " << firstTiles[i] << ", " << image.m_tiles.size() << " }";
+	});
+
+	// Images are found by name through a minimal perfect hash (see PerfectHash.hpp)
+	std::vector<std::string> names;
+	names.reserve(atlas.m_images.size());
+
+	for (auto& image : atlas.m_images)
+		names.push_back(image.m_name);
+
+	auto hash = buildPerfectHash(names);
+
+	out << "constexpr unsigned int nameSeed = " << hash.m_seed << ";\n";
+	out << "constexpr unsigned int numNameBuckets = " << hash.m_displacements.size() << ";\n";
+	out << "constexpr unsigned int numNameSlots = " << hash.m_slots.size() << ";\n\n";
+
+	cppArray(out, "unsigned int", "nameBuckets", hash.m_displacements.size(), [&](std::size_t i) { out << hash.m_displacements[i] << 'u'; });
+	cppArray(out, "unsigned int", "nameSlots", hash.m_slots.size(), [&](std::size_t i) { out << hash.m_slots[i]; });
+
+	// Fonts
+	Identifiers fontIds;
+	std::vector<std::string> fontNames;
+
+	for (unsigned int i = 0; i < atlas.m_fonts.size(); ++i) {
+		auto& font = atlas.m_fonts[i];
+		fontNames.push_back(fontIds.add((font.m_name.empty() ? "font" : font.m_name) + '_' + std::to_string(font.m_size)));
+
+		cppArray(out, "Glyph", fontNames[i] + "_glyphs", font.m_glyphs.size(), [&](std::size_t j) {
+			auto& glyph = font.m_glyphs[j];
+			out << "{ " << glyph.m_code << ", " << (glyph.m_hasTexture ? (int) glyph.m_texture : -1) << ", " << glyph.m_channel << ", "
+				<< glyph.m_x << ", " << glyph.m_y << ", " << glyph.m_width << ", " << glyph.m_height << ", " << (glyph.m_flipped ? "true" : "false") << ", "
+				<< cppFloat(glyph.m_advX) << ", " << cppFloat(glyph.m_advY) << ", " << glyph.m_transX << ", " << glyph.m_transY << " }";
+		});
+
+		auto table = buildPageTable(font);
+		auto& pages = table.m_pages;
+		auto& blocks = table.m_blocks;
+
+		cppArray(out, "unsigned int", fontNames[i] + "_pages", pages.size(), [&](std::size_t j) { out << pages[j]; });
+		cppArray(out, "unsigned int", fontNames[i] + "_blocks", blocks.size(), [&](std::size_t j) { out << blocks[j]; });
+
+		cppArray(out, "Kerning", fontNames[i] + "_kerning", font.m_kerning.size(), [&](std::size_t j) {
+			auto& kerning = font.m_kerning[j];
+			out << "{ " << kerning.m_first << ", " << kerning.m_second << ", " << cppFloat(kerning.m_x) << " }";
+		});
+
+		std::string pairs = "nullptr, 0, nullptr";
+
+		if (kerningHash) {
+			auto hash = hashKerning(font);
+
+			cppArray(out, "unsigned int", fontNames[i] + "_kerningBuckets", hash.m_displacements.size(), [&](std::size_t j) { out << hash.m_displacements[j] << 'u'; });
+			cppArray(out, "unsigned int", fontNames[i] + "_kerningSlots", hash.m_slots.size(), [&](std::size_t j) { out << hash.m_slots[j]; });
+
+			pairs = combine(fontNames[i], "_kerningBuckets, ", std::to_string(hash.m_displacements.size()), ", ", fontNames[i], "_kerningSlots");
+		}
+
+		out << "constexpr Font " << fontNames[i] << " = {\n\t"
+			<< cppString(font.m_name) << ", " << font.m_size << ", " << (font.m_multiChannel ? "true" : "false") << ",\n\t"
+			<< fontNames[i] << "_glyphs, " << font.m_glyphs.size() << ",\n\t"
+			<< fontNames[i] << "_pages, " << pages.size() << ",\n\t"
+			<< fontNames[i] << "_blocks,\n\t"
+			<< fontNames[i] << "_kerning, " << font.m_kerning.size() << ",\n\t"
+			<< pairs << "\n};\n\n";
+	}
+
+	out << "constexpr unsigned int numFonts = " << atlas.m_fonts.size() << ";\n\n";
+
+	cppArray(out, "const Font*", "fonts", atlas.m_fonts.size(), [&](std::size_t i) { out << '&' << fontNames[i]; });
+
+	out <<
+		"constexpr const Image& image(ImageId id) {\n"
+		"\treturn images[(unsigned int) id];\n"
+		"}\n"
+		"\n"
+		"constexpr const Tile& tile(ImageId id, unsigned int i = 0) {\n"
+		"\treturn tiles[images[(unsigned int) id].firstTile + i];\n"
+		"}\n"
+		"\n"
+		"constexpr unsigned long long mixName(unsigned long long value) {\n"
+		"\tvalue = (value ^ (value >> 33)) * 0xFF51AFD7ED558CCDull;\n"
+		"\tvalue = (value ^ (value >> 33)) * 0xC4CEB9FE1A85EC53ull;\n"
+		"\treturn value ^ (value >> 33);\n"
+		"}\n"
+		"\n"
+		"constexpr bool equalNames(const char* a, const char* b) {\n"
+		"\twhile (*a != 0 && *a == *b)\n"
+		"\t\t++a, ++b;\n"
+		"\n"
+		"\treturn *a == *b;\n"
+		"}\n"
+		"\n";
+
+	out << "// Returns nullptr if there is no image with the name, the first image is returned if there are multiple\n";
+
+	// The lookup would divide by zero without images
+	if (hash.m_slots.empty()) {
+		out <<
+			"constexpr const Image* findImage(const char*) {\n"
+			"\treturn nullptr;\n"
+			"}\n"
+			"\n";
+	}
+	else {
+		out <<
+			"constexpr const Image* findImage(const char* name) {\n"
+			"\tauto key = 14695981039346656037ull ^ nameSeed;\n"
+			"\n"
+			"\tfor (auto chr = name; *chr != 0; ++chr)\n"
+			"\t\tkey = (key ^ (unsigned char) *chr) * 1099511628211ull;\n"
+			"\n"
+			"\tauto displacement = nameBuckets[mixName(key) % numNameBuckets];\n"
+			"\tauto& image = images[nameSlots[displacement & 0x80000000u ? displacement & 0x7FFFFFFFu :\n"
+			"\t\t(unsigned int) (mixName(key + displacement * 0x9E3779B97F4A7C15ull) % numNameSlots)]];\n"
+			"\n"
+			"\treturn equalNames(image.name, name) ? &image : nullptr;\n"
+			"}\n"
+			"\n";
+	}
+
+	out <<
+		"// Returns nullptr if the font doesn't contain the character\n"
+		"constexpr const Glyph* findGlyph(const Font& font, unsigned int code) {\n"
+		"\treturn code / 256 >= font.numPages || font.pages[code / 256] == 0 ||\n"
+		"\t\tfont.blocks[(font.pages[code / 256] - 1) * 256 + code % 256] == 0 ? nullptr :\n"
+		"\t\t&font.glyphs[font.blocks[(font.pages[code / 256] - 1) * 256 + code % 256] - 1];\n"
+		"}\n"
+		"\n"
+		"// Returns nullptr if the pair isn't kerned\n"
+		"constexpr const Kerning* findKerning(const Font& font, unsigned int first, unsigned int second) {\n"
+		"\tif (font.numKerningBuckets != 0) {\n"
+		"\t\tauto key = (unsigned long long) first << 32 | second;\n"
+		"\t\tauto displacement = font.kerningBuckets[mixName(key) % font.numKerningBuckets];\n"
+		"\t\tauto& kerning = font.kerning[font.kerningSlots[displacement & 0x80000000u ? displacement & 0x7FFFFFFFu :\n"
+		"\t\t\t(unsigned int) (mixName(key + displacement * 0x9E3779B97F4A7C15ull) % font.numKerning)]];\n"
+		"\n"
+		"\t\treturn kerning.first == first && kerning.second == second ? &kerning : nullptr;\n"
+		"\t}\n"
+		"\n"
+		"\t// Pairs which aren't hashed are searched\n"
+		"\tunsigned int beg = 0, end = font.numKerning;\n"
+		"\n"
+		"\twhile (beg < end) {\n"
+		"\t\tauto mid = beg + (end - beg) / 2;\n"
+		"\n"
+		"\t\tif (font.kerning[mid].first < first || (font.kerning[mid].first == first && font.kerning[mid].second < second))\n"
+		"\t\t\tbeg = mid + 1;\n"
+		"\t\telse\n"
+		"\t\t\tend = mid;\n"
+		"\t}\n"
+		"\n"
+		"\treturn beg < font.numKerning && font.kerning[beg].first == first && font.kerning[beg].second == second ? &font.kerning[beg] : nullptr;\n"
+		"}\n"
+		"\n"
+		"}\n";
+
+	auto f = finalize(fopen(file.c_str(), "wb"), fclose);
+
+	if (!f)
+		throw std::runtime_error(combine("failed to open file (\"", file, "\")"));
+
+	auto data = out.str();
+
+	if (fwrite(data.data(), 1, data.size(), f.get()) != data.size())
+		throw std::runtime_error(combine("failed to write file (\"", file, "\")"));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Rectangle.hpp"
+
+// Metadata of the generated atlas, which is written as JSON or in binary form
+
+struct AtlasTexture {
+	std::string m_file;
+	unsigned int m_width;
+	unsigned int m_height;
+};
+
+// Part of an image in a texture, the offset is relative to the trimmed image
+struct AtlasTile {
+	unsigned int m_texture;
+	unsigned int m_offsetX;
+	unsigned int m_offsetY;
+	unsigned int m_x;
+	unsigned int m_y;
+	unsigned int m_width;
+	unsigned int m_height;
+	bool m_flipped;
+};
+
+// Transparent images have no tiles
+struct AtlasImage {
+	std::string m_name;
+	unsigned int m_realWidth;
+	unsigned int m_realHeight;
+	Rectangle m_bounds;
+	unsigned int m_columns;
+	unsigned int m_rows;
+	std::vector<AtlasTile> m_tiles;
+};
+
+// Glyphs without image (e.g. spaces) have no texture
+struct AtlasGlyph {
+	unsigned int m_code;
+	bool m_hasTexture;
+	unsigned int m_texture;
+	unsigned int m_channel;
+	unsigned int m_x;
+	unsigned int m_y;
+	unsigned int m_width;
+	unsigned int m_height;
+	bool m_flipped;
+	float m_advX;
+	float m_advY;
+	int m_transX;
+	int m_transY;
+};
+
+struct AtlasKerning {
+	unsigned int m_first;
+	unsigned int m_second;
+	float m_x;
+};
+
+struct AtlasFont {
+	std::string m_name;
+	unsigned int m_size;
+	bool m_multiChannel;
+	std::vector<AtlasGlyph> m_glyphs;
+	std::vector<AtlasKerning> m_kerning;
+};
+
+struct Atlas {
+	// Flipped isn't written if images can't be rotated, channels only if glyphs are packed into channels
+	bool m_canFlip = true;
+	bool m_channels = false;
+
+	std::vector<AtlasTexture> m_textures;
+	std::vector<AtlasImage> m_images;
+	std::vector<AtlasFont> m_fonts;
+};
+
+// Compact JSON contains no whitespace
+void saveJSON(const Atlas& atlas, const std::string& file, bool compact = false);
+
+// Layout is described in include/mkatlas.h. Kerning pairs are also hashed if kerningHash is set.
+void saveBinary(const Atlas& atlas, const std::string& file, bool kerningHash = false);
+
+// Writes the metadata as constexpr tables of a C++ header. Kerning pairs are also hashed if kerningHash is set.
+void saveHeader(const Atlas& atlas, const std::string& file, bool kerningHash = false);
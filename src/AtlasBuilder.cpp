@@ -0,0 +1,674 @@
+#include "AtlasBuilder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+#include "Dedup.hpp"
+#include "MaxRects.hpp"
+#include "Tiling.hpp"
+
+unsigned int AtlasPage::width() const {
+	return m_canvas ? m_canvas->width() : m_layers[0].width();
+}
+
+unsigned int AtlasPage::height() const {
+	return m_canvas ? m_canvas->height() : m_layers[0].height();
+}
+
+Image AtlasPage::getImage() const {
+	assert(channels() == 4);
+
+	if (m_canvas)
+		return m_canvas->getImage();
+
+	// Every layer is one channel
+	Image img(width(), height());
+	std::vector<unsigned char> row(width());
+
+	for (unsigned int y = 0; y < height(); ++y)
+		for (unsigned int c = 0; c < m_numLayers; ++c)
+			if (m_layers[c].readRow(y, row.data()))
+				for (unsigned int x = 0; x < width(); ++x)
+					img.at(x, y) |= (unsigned int) row[x] << (c * 8);
+
+	return img;
+}
+
+GrayImage AtlasPage::getGrayImage() const {
+	assert(channels() == 1);
+	return m_layers[0].getImage();
+}
+
+unsigned long long AtlasPage::hash() const {
+	auto hash = hashBytes(nullptr, 0, (unsigned long long) width() << 32 | height());
+
+	// Rows without pixels are hashed as transparent
+	if (m_canvas) {
+		std::vector<unsigned int> row(width());
+
+		for (unsigned int y = 0; y < height(); ++y) {
+			if (!m_canvas->readRow(y, row.data()))
+				std::fill(row.begin(), row.end(), 0);
+
+			hash = hashBytes(row.data(), row.size() * sizeof(unsigned int), hash);
+		}
+	}
+	else {
+		std::vector<unsigned char> row(width());
+
+		for (unsigned int c = 0; c < m_numLayers; ++c) {
+			for (unsigned int y = 0; y < height(); ++y) {
+				if (!m_layers[c].readRow(y, row.data()))
+					std::fill(row.begin(), row.end(), 0);
+
+				hash = hashBytes(row.data(), row.size(), hash);
+			}
+		}
+	}
+
+	return hash;
+}
+
+void AtlasPage::save(const std::string& file) const {
+	if (m_canvas)
+		m_canvas->save(file);
+	else if (m_numLayers == 1)
+		m_layers[0].save(file);
+	else
+		saveChannels(file, m_layers, m_numLayers);
+}
+
+// Rounds a shrunk texture size up to the requested alignment
+static unsigned int alignSize(unsigned int size, unsigned int max, bool powerOfTwo, unsigned int align) {
+	if (powerOfTwo) {
+		unsigned int pot = 1;
+
+		while (pot < size)
+			pot <<= 1;
+
+		size = pot;
+	}
+
+	if (align > 1)
+		size = (size + align - 1) / align * align;
+
+	return std::min(size, max);
+}
+
+#ifndef DISABLE_FREETYPE
+// Grayscale textures contain the glyphs as they are
+static const GrayImage& glyphImage(const GrayCanvas&, const Glyph& glyph, const FontOptions&) {
+	return glyph.m_img;
+}
+
+// RGBA textures contain the glyphs in the color of the font (or as opaque gray if it's a distant field)
+static Image glyphImage(const Canvas&, const Glyph& glyph, const FontOptions& font) {
+	if (font.m_multiChannel)
+		return glyph.m_colorImg;
+
+	if (font.m_distantFieldSpread != 0)
+		return imageFromGray(glyph.m_img);
+
+	return imageFromAlpha(glyph.m_img, font.m_color);
+}
+#endif
+
+AtlasBuilder::AtlasBuilder(const AtlasOptions& opt, ThreadPool& pool):
+	m_opt(opt), m_pool(pool), m_images((std::size_t) opt.m_memoryBudget << 20) { }
+
+void AtlasBuilder::addImage(const std::string& name, Image img) {
+	m_imageNames.push_back(name);
+	m_images.add(std::move(img), m_opt.m_trim);
+	m_imageChanged.push_back(true);
+}
+
+void AtlasBuilder::addImageFile(const std::string& name, const std::string& file) {
+	m_imageNames.push_back(name);
+	m_images.add(file, m_opt.m_trim);
+	m_imageChanged.push_back(true);
+}
+
+void AtlasBuilder::addUnchangedImageFile(const std::string& name, const std::string& file, unsigned int width, unsigned int height, const Rectangle& bounds, unsigned long long hash) {
+	m_imageNames.push_back(name);
+	m_images.add(file, width, height, bounds, hash);
+	m_imageChanged.push_back(false);
+}
+
+#ifndef DISABLE_FREETYPE
+void AtlasBuilder::addFont(const FontOptions& font) {
+	if (font.m_multiChannel && font.m_distantFieldSpread < font.m_distantFieldSize)
+		throw std::runtime_error(combine("multi channel distant field needs a spread (\"", font.m_file, "\")"));
+
+	m_fontOptions.push_back(font);
+	m_fonts.emplace_back();
+	m_fontLoaded.push_back(false);
+	m_fontChanged.push_back(true);
+}
+
+void AtlasBuilder::addUnchangedFont(const FontOptions& font) {
+	addFont(font);
+	m_fontChanged.back() = false;
+}
+
+void AtlasBuilder::addFont(const FontOptions& font, Font glyphs) {
+	m_fontOptions.push_back(font);
+	m_fonts.push_back(std::move(glyphs));
+	m_fontLoaded.push_back(true);
+	m_fontChanged.push_back(true);
+}
+#endif
+
+bool AtlasBuilder::isLayoutValid(const AtlasLayout& layout, const std::vector<TileGrid>& imageTiles) const {
+	auto layers = m_opt.m_channels ? 4u : 1u;
+
+	if (layout.m_images.size() != imageTiles.size() || layout.m_textureSizes.size() != (layout.m_numBins + layers - 1) / layers ||
+		layout.m_textureSizes.size() != layout.m_textureHashes.size())
+		return false;
+
+	// Rectangles have to be inside of the bins
+	auto isInside = [&layout, this](const RectData& rect, unsigned int w, unsigned int h) {
+		auto right = (unsigned long long) rect.m_x + (rect.m_flipped ? rect.m_h : rect.m_w);
+		auto bottom = (unsigned long long) rect.m_y + (rect.m_flipped ? rect.m_w : rect.m_h);
+
+		return rect.m_w == w + m_opt.m_padding && rect.m_h == h + m_opt.m_padding && (rect.m_bin < layout.m_numBins || layout.m_numBins == 0) &&
+			right <= layout.m_width + m_opt.m_padding && bottom <= layout.m_height + m_opt.m_padding;
+	};
+
+	for (unsigned int i = 0; i < imageTiles.size(); ++i) {
+		auto& rects = layout.m_images[i];
+		auto& tiles = imageTiles[i].m_tiles;
+
+		if (rects.size() != tiles.size())
+			return false;
+
+		for (unsigned int j = 0; j < tiles.size(); ++j)
+			if (!isInside(rects[j], tiles[j].m_w, tiles[j].m_h))
+				return false;
+	}
+
+#ifndef DISABLE_FREETYPE
+	if (layout.m_fonts.size() != m_fonts.size())
+		return false;
+
+	for (unsigned int i = 0; i < m_fonts.size(); ++i) {
+		auto& rects = layout.m_fonts[i];
+		auto& glyphs = m_fonts[i].m_glyphs;
+
+		// Glyphs of changed fonts could be deduplicated differently
+		if (m_fontChanged[i] || rects.size() != glyphs.size())
+			return false;
+
+		for (unsigned int j = 0; j < glyphs.size(); ++j)
+			if (!isInside(rects[j], glyphs[j].width(), glyphs[j].height()))
+				return false;
+	}
+#else
+	if (!layout.m_fonts.empty())
+		return false;
+#endif
+
+	return true;
+}
+
+Atlas AtlasBuilder::build(const std::function<void(unsigned int, const AtlasPage&)>& page, const AtlasLayout* previous) {
+	auto& opt = m_opt;
+	auto& images = m_images;
+
+	if (opt.m_gray && opt.m_channels)
+		throw std::runtime_error("grayscale textures can't be packed into channels");
+
+	if (opt.m_gray || opt.m_channels) {
+		if (images.size() != 0)
+			throw std::runtime_error("single channel textures can't contain images");
+
+	#ifndef DISABLE_FREETYPE
+		for (auto& font : m_fontOptions)
+			if (font.m_multiChannel)
+				throw std::runtime_error(combine("single channel textures can't contain multi channel distant fields (\"", font.m_file, "\")"));
+	#endif
+	}
+
+	// Packed textures are made of four layers (one per channel), every layer is a separate bin
+	auto layers = opt.m_channels ? 4u : 1u;
+
+#ifndef DISABLE_FREETYPE
+	// Load fonts, all fonts are loaded concurrently
+	auto& fonts = m_fonts;
+	FreeType ft(m_pool, m_cache);
+
+	m_pool.parallelFor(m_fontOptions.size(), [&](unsigned int i) {
+		auto& font = m_fontOptions[i];
+
+		if (m_fontLoaded[i])
+			return;
+
+		// Outlines are sampled at the target size, the spread is scaled down accordingly
+		if (font.m_multiChannel)
+			fonts[i] = ft.loadMultiDistantField(font.m_file, font.m_size, font.m_distantFieldSpread / font.m_distantFieldSize, font.m_ranges);
+		else if (font.m_distantFieldSpread != 0)
+			fonts[i] = ft.loadDistantField(font.m_file, font.m_size, font.m_distantFieldSpread, font.m_distantFieldSize, font.m_ranges);
+		else
+			fonts[i] = ft.load(font.m_file, font.m_size * font.m_distantFieldSize, font.m_ranges);
+
+		// Kerning uses the same size as the glyphs, outlines aren't hinted
+		if (font.m_kerning)
+			ft.loadKerning(font.m_file, font.m_multiChannel ? font.m_size : font.m_size * font.m_distantFieldSize, !font.m_multiChannel, fonts[i]);
+	});
+
+	std::fill(m_fontLoaded.begin(), m_fontLoaded.end(), true);
+
+	// Glyphs which look the same are only packed once (in any font)
+	std::vector<std::pair<unsigned int, unsigned int>> glyphList;
+
+	for (unsigned int i = 0; i < fonts.size(); ++i)
+		for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
+			if (!fonts[i].m_glyphs[j].empty())
+				glyphList.push_back({ i, j });
+
+	// Glyphs are drawn differently depending on the font and the textures
+	auto glyphStyle = [this](unsigned int i) -> unsigned long long {
+		auto& font = m_fontOptions[i];
+
+		if (font.m_multiChannel)
+			return 1ull << 32;
+
+		if (m_opt.m_gray || m_opt.m_channels)
+			return 0;
+
+		return font.m_distantFieldSpread != 0 ? 2ull << 32 : 3ull << 32 | font.m_color;
+	};
+
+	auto glyphBytes = [&fonts](unsigned int i, unsigned int j) -> std::pair<const void*, std::size_t> {
+		auto& glyph = fonts[i].m_glyphs[j];
+
+		if (!glyph.m_colorImg.empty())
+			return { glyph.m_colorImg.data(), glyph.width() * glyph.height() * sizeof(unsigned int) };
+
+		return { glyph.m_img.data(), glyph.width() * glyph.height() };
+	};
+
+	auto uniqueGlyphs = findDuplicates(glyphList.size(), [&](unsigned int k) {
+		auto bytes = glyphBytes(glyphList[k].first, glyphList[k].second);
+		return hashBytes(bytes.first, bytes.second, glyphStyle(glyphList[k].first) ^ fonts[glyphList[k].first].m_glyphs[glyphList[k].second].width());
+	}, [&](unsigned int a, unsigned int b) {
+		auto& glyphA = fonts[glyphList[a].first].m_glyphs[glyphList[a].second];
+		auto& glyphB = fonts[glyphList[b].first].m_glyphs[glyphList[b].second];
+		auto bytesA = glyphBytes(glyphList[a].first, glyphList[a].second);
+		auto bytesB = glyphBytes(glyphList[b].first, glyphList[b].second);
+
+		return glyphStyle(glyphList[a].first) == glyphStyle(glyphList[b].first) &&
+			glyphA.width() == glyphB.width() && glyphA.height() == glyphB.height() &&
+			bytesA.second == bytesB.second && memcmp(bytesA.first, bytesB.first, bytesA.second) == 0;
+	});
+
+	// Every glyph points to the glyph which is packed for it (usually itself)
+	std::vector<std::vector<std::pair<unsigned int, unsigned int>>> glyphSources(fonts.size());
+
+	for (unsigned int i = 0; i < fonts.size(); ++i)
+		for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
+			glyphSources[i].push_back({ i, j });
+
+	for (unsigned int k = 0; k < glyphList.size(); ++k)
+		glyphSources[glyphList[k].first][glyphList[k].second] = glyphList[uniqueGlyphs[k]];
+#endif
+
+	// Split images which are larger than a texture into tiles
+	std::vector<TileGrid> imageTiles;
+	imageTiles.reserve(images.size());
+
+	for (unsigned int i = 0; i < images.size(); ++i)
+		imageTiles.push_back(splitIntoTiles(
+			images.getBounds(i).m_w, images.getBounds(i).m_h,
+			(opt.m_autoSize ? opt.m_maxSize : opt.m_width) - (opt.m_expand ? opt.m_padding : 0),
+			(opt.m_autoSize ? opt.m_maxSize : opt.m_height) - (opt.m_expand ? opt.m_padding : 0),
+			opt.m_padding, !opt.m_noFlip
+		));
+
+	auto width = opt.m_width;
+	auto height = opt.m_height;
+
+	std::vector<std::vector<RectData>> imageRects;
+	unsigned int numBins = 0;
+	std::vector<Rectangle> textureSizes;
+	AtlasLayout layout;
+
+#ifndef DISABLE_FREETYPE
+	std::vector<std::vector<RectData>> fontRects;
+#endif
+
+	// Images which share rectangles in the layout are duplicates, but only as long as they didn't change
+	m_layoutReused = previous && isLayoutValid(*previous, imageTiles);
+	std::vector<unsigned int> imageSources(images.size());
+
+	if (m_layoutReused) {
+		std::map<std::tuple<unsigned int, unsigned int, unsigned int>, unsigned int> owners;
+
+		for (unsigned int i = 0; i < images.size(); ++i) {
+			auto& rects = previous->m_images[i];
+			imageSources[i] = i;
+
+			if (rects.empty() || rects[0].m_w <= opt.m_padding || rects[0].m_h <= opt.m_padding)
+				continue;
+
+			auto owner = owners.emplace(std::make_tuple(rects[0].m_bin, rects[0].m_x, rects[0].m_y), i);
+
+			if (!owner.second) {
+				imageSources[i] = owner.first->second;
+
+				if (m_imageChanged[i] || m_imageChanged[owner.first->second])
+					m_layoutReused = false;
+			}
+		}
+
+		// Changed images which became identical to another image are packed again, so they are only packed once
+		std::multimap<unsigned long long, unsigned int> hashes;
+
+		for (unsigned int i = 0; i < images.size(); ++i)
+			hashes.emplace(images.getHash(i), i);
+
+		for (unsigned int i = 0; i < images.size() && m_layoutReused; ++i) {
+			if (!m_imageChanged[i])
+				continue;
+
+			auto range = hashes.equal_range(images.getHash(i));
+
+			for (auto it = range.first; it != range.second && m_layoutReused; ++it)
+				if (it->second != i && imageSources[it->second] != imageSources[i] && images.isEqual(i, it->second))
+					m_layoutReused = false;
+		}
+	}
+
+	if (m_layoutReused) {
+		width = previous->m_width;
+		height = previous->m_height;
+		numBins = previous->m_numBins;
+		layout.m_autoSize = previous->m_autoSize;
+		imageRects = previous->m_images;
+		textureSizes = previous->m_textureSizes;
+
+	#ifndef DISABLE_FREETYPE
+		fontRects = previous->m_fonts;
+	#endif
+	}
+	else {
+		// Images with identical (trimmed) pixels are only packed once
+		imageSources = findDuplicates(images.size(), [&images](unsigned int i) {
+			return images.getHash(i);
+		}, [&images](unsigned int a, unsigned int b) {
+			return images.isEqual(a, b);
+		});
+
+		// Search the smallest texture size
+		if (opt.m_autoSize) {
+			std::vector<Rectangle> rects;
+
+			for (unsigned int i = 0; i < imageTiles.size(); ++i)
+				if (imageSources[i] == i)
+					for (auto& tile : imageTiles[i].m_tiles)
+						rects.push_back({ 0, 0, tile.m_w + opt.m_padding, tile.m_h + opt.m_padding });
+
+		#ifndef DISABLE_FREETYPE
+			for (unsigned int i = 0; i < fonts.size(); ++i)
+				for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
+					if (glyphSources[i][j] == std::make_pair(i, j))
+						rects.push_back({ 0, 0, fonts[i].m_glyphs[j].width() + opt.m_padding, fonts[i].m_glyphs[j].height() + opt.m_padding });
+		#endif
+
+			rects.erase(std::remove_if(rects.begin(), rects.end(), [](auto& rect) { return rect.m_w == 0 || rect.m_h == 0; }), rects.end());
+
+			layout.m_autoSize = findMinimalSize(rects, {
+				opt.m_maxSize, std::max(opt.m_maxTextures, 1u) * layers, opt.m_expand ? 0 : opt.m_padding,
+				opt.m_align, opt.m_powerOfTwo, !opt.m_noFlip
+			}, m_pool);
+
+			width = layout.m_autoSize.m_width;
+			height = layout.m_autoSize.m_height;
+		}
+
+		MaxRects mr({
+			opt.m_expand ? width : width + opt.m_padding,
+			opt.m_expand ? height : height + opt.m_padding,
+			opt.m_maxTextures * layers, !opt.m_noFlip
+		});
+
+		// Add images to rectangle packer
+		imageRects.reserve(images.size());
+
+		for (unsigned int i = 0; i < imageTiles.size(); ++i) {
+			auto& grid = imageTiles[i];
+			imageRects.emplace_back(grid.m_tiles.size());
+
+			if (imageSources[i] == i)
+				for (unsigned int j = 0; j < grid.m_tiles.size(); ++j)
+					mr.add(&imageRects.back()[j], grid.m_tiles[j].m_w + opt.m_padding, grid.m_tiles[j].m_h + opt.m_padding);
+		}
+
+	#ifndef DISABLE_FREETYPE
+		// Add glyphs to rectangle packer
+		fontRects.reserve(fonts.size());
+
+		for (unsigned int i = 0; i < fonts.size(); ++i) {
+			fontRects.emplace_back(fonts[i].m_glyphs.size());
+
+			for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
+				if (glyphSources[i][j] == std::make_pair(i, j))
+					mr.add(&fontRects.back()[j], fonts[i].m_glyphs[j].width() + opt.m_padding, fonts[i].m_glyphs[j].height() + opt.m_padding);
+		}
+	#endif
+
+		if (!mr.pack())
+			throw std::runtime_error("failed to pack rectangles");
+
+		numBins = mr.getNumBins();
+
+		// Duplicates share the placement of their source
+		for (unsigned int i = 0; i < images.size(); ++i)
+			imageRects[i] = imageRects[imageSources[i]];
+
+	#ifndef DISABLE_FREETYPE
+		for (unsigned int i = 0; i < fonts.size(); ++i)
+			for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
+				fontRects[i][j] = fontRects[glyphSources[i][j].first][glyphSources[i][j].second];
+	#endif
+
+		// Calculate size of textures, if shrinking is enabled only the used area is kept
+		textureSizes.assign((numBins + layers - 1) / layers, { 0, 0, width, height });
+
+		if (opt.m_shrink) {
+			for (auto& size : textureSizes)
+				size.m_w = size.m_h = 0;
+
+			auto extend = [&opt, &textureSizes, layers](const RectData& rect) {
+				// Padding is only drawn if the borders are expanded
+				if (rect.m_w <= opt.m_padding || rect.m_h <= opt.m_padding)
+					return;
+
+				auto w = opt.m_expand ? rect.m_w : rect.m_w - opt.m_padding;
+				auto h = opt.m_expand ? rect.m_h : rect.m_h - opt.m_padding;
+
+				auto& size = textureSizes[rect.m_bin / layers];
+				size.m_w = std::max(size.m_w, rect.m_x + (rect.m_flipped ? h : w));
+				size.m_h = std::max(size.m_h, rect.m_y + (rect.m_flipped ? w : h));
+			};
+
+			for (auto& rects : imageRects)
+				for (auto& rect : rects)
+					extend(rect);
+
+		#ifndef DISABLE_FREETYPE
+			for (auto& rects : fontRects)
+				for (auto& rect : rects)
+					extend(rect);
+		#endif
+
+			for (auto& size : textureSizes) {
+				size.m_w = alignSize(std::max(size.m_w, 1u), width, opt.m_powerOfTwo, opt.m_align);
+				size.m_h = alignSize(std::max(size.m_h, 1u), height, opt.m_powerOfTwo, opt.m_align);
+			}
+		}
+	}
+
+	auto numTextures = (unsigned int) textureSizes.size();
+
+	// Compose one texture at a time, so only a single canvas is in memory
+	std::vector<std::vector<std::pair<unsigned int, unsigned int>>> binImages(numBins);
+
+	for (unsigned int i = 0; i < images.size(); ++i)
+		if (images.getBounds(i).m_w != 0 && images.getBounds(i).m_h != 0 && imageSources[i] == i)
+			for (unsigned int j = 0; j < imageRects[i].size(); ++j)
+				binImages[imageRects[i][j].m_bin].push_back({ i, j });
+
+	// If the layout is kept, only textures which contain changed images are composed again
+	std::vector<bool> changedTextures(numTextures, !m_layoutReused);
+
+	for (unsigned int bin = 0; bin < binImages.size(); ++bin)
+		for (auto& tile : binImages[bin])
+			if (m_imageChanged[tile.first])
+				changedTextures[bin / layers] = true;
+
+	layout.m_textureHashes.resize(numTextures);
+
+	// Textures which are identical to the texture of the previous build are marked, so they aren't saved again
+	auto passPage = [&](unsigned int bin, AtlasPage texture) {
+		layout.m_textureHashes[bin] = texture.hash();
+		texture.m_unchanged = previous && bin < previous->m_textureHashes.size() && previous->m_textureHashes[bin] == layout.m_textureHashes[bin];
+
+		page(bin, texture);
+	};
+
+#ifndef DISABLE_FREETYPE
+	auto drawGlyphs = [&](auto& canvas, unsigned int bin) {
+		for (unsigned int i = 0; i < fonts.size(); ++i)
+			for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
+				if (fontRects[i][j].m_bin == bin && glyphSources[i][j] == std::make_pair(i, j))
+					canvas.draw(glyphImage(canvas, fonts[i].m_glyphs[j], m_fontOptions[i]), fontRects[i][j].m_x, fontRects[i][j].m_y, fontRects[i][j].m_flipped, opt.m_expand ? opt.m_padding : 0);
+	};
+#endif
+
+	for (unsigned int bin = 0; bin < numTextures; ++bin) {
+		if (!changedTextures[bin]) {
+			layout.m_textureHashes[bin] = previous->m_textureHashes[bin];
+			continue;
+		}
+
+		// Every channel is drawn separately and they are combined when saved
+		if (opt.m_channels) {
+		#ifndef DISABLE_FREETYPE
+			std::vector<GrayCanvas> channels;
+			channels.reserve(layers);
+
+			for (unsigned int c = 0; c < layers; ++c) {
+				channels.emplace_back(textureSizes[bin].m_w, textureSizes[bin].m_h);
+				drawGlyphs(channels.back(), bin * layers + c);
+			}
+
+			passPage(bin, AtlasPage(nullptr, channels.data(), layers));
+		#endif
+			continue;
+		}
+
+		// Grayscale textures only contain glyphs
+		if (opt.m_gray) {
+		#ifndef DISABLE_FREETYPE
+			GrayCanvas canvas(textureSizes[bin].m_w, textureSizes[bin].m_h);
+			drawGlyphs(canvas, bin);
+			passPage(bin, AtlasPage(nullptr, &canvas, 1));
+		#endif
+			continue;
+		}
+
+		Canvas canvas(textureSizes[bin].m_w, textureSizes[bin].m_h);
+
+		// The tiles of an image are next to each other, so every image is only fetched (and maybe decoded) once
+		auto& tiles = binImages[bin];
+
+		for (unsigned int first = 0, last = 0; first < tiles.size(); first = last) {
+			auto i = tiles[first].first;
+			auto& img = images.get(i);
+
+			for (last = first; last < tiles.size() && tiles[last].first == i; ++last) {
+				auto& rect = imageRects[i][tiles[last].second];
+
+				if (imageTiles[i].m_tiles.size() == 1)
+					canvas.draw(img, rect.m_x, rect.m_y, rect.m_flipped, opt.m_expand ? opt.m_padding : 0);
+				else
+					canvas.drawRect(img, imageTiles[i].m_tiles[tiles[last].second], rect.m_x, rect.m_y, rect.m_flipped, opt.m_expand ? opt.m_padding : 0);
+			}
+		}
+
+	#ifndef DISABLE_FREETYPE
+		drawGlyphs(canvas, bin);
+	#endif
+
+		passPage(bin, AtlasPage(&canvas, nullptr, 0));
+	}
+
+	layout.m_width = width;
+	layout.m_height = height;
+	layout.m_numBins = numBins;
+	layout.m_images = imageRects;
+	layout.m_textureSizes = textureSizes;
+
+#ifndef DISABLE_FREETYPE
+	layout.m_fonts = fontRects;
+#endif
+
+	// Collect metadata
+	Atlas atlas;
+	atlas.m_canFlip = !opt.m_noFlip;
+	atlas.m_channels = opt.m_channels;
+
+	for (unsigned int i = 0; i < numTextures; ++i)
+		atlas.m_textures.push_back({ std::string(), textureSizes[i].m_w, textureSizes[i].m_h });
+
+	atlas.m_images.reserve(images.size());
+
+	for (unsigned int i = 0; i < images.size(); ++i) {
+		auto& bounds = images.getBounds(i);
+		auto& grid = imageTiles[i];
+
+		atlas.m_images.push_back({ m_imageNames[i], images.width(i), images.height(i), bounds, grid.m_columns, grid.m_rows, { } });
+
+		if (images.empty(i) || (bounds.m_w == 0 && bounds.m_h == 0))
+			continue;
+
+		for (unsigned int j = 0; j < grid.m_tiles.size(); ++j) {
+			auto& rect = imageRects[i][j];
+			auto& tile = grid.m_tiles[j];
+
+			atlas.m_images.back().m_tiles.push_back({ rect.m_bin, tile.m_x, tile.m_y, rect.m_x, rect.m_y, tile.m_w, tile.m_h, rect.m_flipped });
+		}
+	}
+
+#ifndef DISABLE_FREETYPE
+	atlas.m_fonts.reserve(fonts.size());
+
+	for (unsigned int i = 0; i < fonts.size(); ++i) {
+		atlas.m_fonts.push_back({ m_fontOptions[i].m_name, m_fontOptions[i].m_size, m_fontOptions[i].m_multiChannel, { }, { } });
+
+		auto& font = atlas.m_fonts.back();
+		font.m_glyphs.reserve(fonts[i].m_chars.size());
+
+		// Characters which share a glyph are written with the same data
+		for (auto& chr : fonts[i].m_chars) {
+			auto& glyph = fonts[i].m_glyphs[chr.second];
+			auto& rect = fontRects[i][chr.second];
+
+			font.m_glyphs.push_back({
+				chr.first, !glyph.empty(), rect.m_bin / layers, rect.m_bin % layers, rect.m_x, rect.m_y,
+				glyph.width(), glyph.height(), rect.m_flipped, glyph.advX, glyph.advY, glyph.transX, glyph.transY
+			});
+		}
+
+		for (auto& kerning : fonts[i].m_kerning)
+			font.m_kerning.push_back({ kerning.m_first, kerning.m_second, kerning.m_x });
+	}
+#endif
+
+	m_layout = std::move(layout);
+	return atlas;
+}
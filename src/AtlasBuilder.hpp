@@ -0,0 +1,202 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Atlas.hpp"
+#include "AutoSize.hpp"
+#include "Canvas.hpp"
+#include "Image.hpp"
+#include "ImageCache.hpp"
+#include "MaxRects.hpp"
+#include "Range.hpp"
+#include "ThreadPool.hpp"
+#include "Tiling.hpp"
+#include "Utils.hpp"
+
+#ifndef DISABLE_FREETYPE
+	#include "Font.hpp"
+	#include "GlyphCache.hpp"
+#endif
+
+#ifndef DISABLE_FREETYPE
+struct FontOptions {
+	std::string m_file;
+	std::string m_name;
+	unsigned int m_size = 0;
+	unsigned int m_color = makeRBGA(0xFF, 0xFF, 0xFF, 0);
+	unsigned int m_distantFieldSize = 1;
+	unsigned int m_distantFieldSpread = 0;
+	bool m_multiChannel = false;
+	bool m_kerning = false;
+	std::vector<Range> m_ranges;
+};
+#endif
+
+// Options of the packing and the textures
+struct AtlasOptions {
+	unsigned int m_maxTextures = 0;
+	bool m_expand = false;
+	bool m_trim = false;
+	bool m_noFlip = false;
+	bool m_shrink = false;
+	bool m_powerOfTwo = false;
+	bool m_gray = false;
+	bool m_channels = false;
+	unsigned int m_align = 1;
+	unsigned int m_padding = 0;
+	unsigned int m_width = 1024;
+	unsigned int m_height = 1024;
+	bool m_autoSize = false;
+	unsigned int m_maxSize = 4096;
+	unsigned int m_memoryBudget = 0;
+};
+
+// Placement of everything which was packed, an incremental build reuses it if only the pixels of some images changed
+struct AtlasLayout {
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+	unsigned int m_numBins = 0;
+	AutoSizeResult m_autoSize = { 0, 0, 0, 0.0 };
+
+	// Rectangles of the tiles of every image and of the glyphs of every font (including padding)
+	std::vector<std::vector<RectData>> m_images;
+	std::vector<std::vector<RectData>> m_fonts;
+
+	// Size and hash of the pixels of every texture
+	std::vector<Rectangle> m_textureSizes;
+	std::vector<unsigned long long> m_textureHashes;
+};
+
+// Composed texture, which is only valid while it's passed to the callback of AtlasBuilder::build.
+// Grayscale textures have a single channel, all others four (RGBA).
+class AtlasPage {
+public:
+	unsigned int width() const;
+	unsigned int height() const;
+
+	inline unsigned int channels() const {
+		return m_canvas || m_numLayers > 1 ? 4 : 1;
+	}
+
+	// Only for textures with four channels
+	Image getImage() const;
+
+	// Only for textures with a single channel
+	GrayImage getGrayImage() const;
+
+	void save(const std::string& file) const;
+
+	// The pixels are identical to the texture of the previous build
+	inline bool isUnchanged() const {
+		return m_unchanged;
+	}
+
+private:
+	friend class AtlasBuilder;
+
+	unsigned long long hash() const;
+
+	AtlasPage(const Canvas* canvas, const GrayCanvas* layers, unsigned int numLayers): m_canvas(canvas), m_layers(layers), m_numLayers(numLayers) { }
+
+	const Canvas* m_canvas;
+	const GrayCanvas* m_layers;
+	unsigned int m_numLayers;
+	bool m_unchanged = false;
+};
+
+// Packs images and glyphs into textures without touching the disk (unless images are added as files).
+// Everything which is added is kept, so an atlas can be built again after adding more.
+class AtlasBuilder {
+public:
+	AtlasBuilder(const AtlasOptions& opt, ThreadPool& pool);
+
+	void addImage(const std::string& name, Image img);
+
+	// The file is loaded immediately, but only kept in memory if it fits into the memory budget
+	void addImageFile(const std::string& name, const std::string& file);
+
+	// The image didn't change since the previous build, it's only decoded if its texture is composed again.
+	// The hash is the one of getImageHash (of the previous build).
+	void addUnchangedImageFile(const std::string& name, const std::string& file, unsigned int width, unsigned int height, const Rectangle& bounds, unsigned long long hash);
+
+	// Hash of the (trimmed) pixels of an image
+	inline unsigned long long getImageHash(unsigned int i) const {
+		return m_images.getHash(i);
+	}
+
+#ifndef DISABLE_FREETYPE
+	// Rendered glyphs are looked up in and added to the cache, the cache isn't saved
+	inline void setGlyphCache(GlyphCache* cache) {
+		m_cache = cache;
+	}
+
+	// The font is rendered by build
+	void addFont(const FontOptions& font);
+
+	// The font (and its options) didn't change since the previous build, it's still rendered by build
+	void addUnchangedFont(const FontOptions& font);
+
+	// Adds glyphs which are already rendered (only the name, size and style of the options are used)
+	void addFont(const FontOptions& font, Font glyphs);
+
+	inline unsigned int getNumFonts() const {
+		return m_fonts.size();
+	}
+
+	// Fonts are rendered by build, all at once
+	inline bool isFontLoaded(unsigned int i) const {
+		return m_fontLoaded[i];
+	}
+
+	inline const Font& getFont(unsigned int i) const {
+		return m_fonts[i];
+	}
+#endif
+
+	// Packs everything and composes one texture at a time, which is passed to page. The file names of
+	// the textures in the metadata are empty.
+	//
+	// If the layout of a previous build (with the same options) is passed, its placement is kept as long as
+	// changed images still fit into their rectangles and no font changed. Only textures which contain changed
+	// images are composed and passed to page then.
+	Atlas build(const std::function<void(unsigned int, const AtlasPage&)>& page, const AtlasLayout* previous = nullptr);
+
+	// Layout of the last build
+	inline const AtlasLayout& getLayout() const {
+		return m_layout;
+	}
+
+	// The last build kept the placement of the previous build
+	inline bool isLayoutReused() const {
+		return m_layoutReused;
+	}
+
+	// Size which was found by the last build (if the size is automatic)
+	inline const AutoSizeResult& getAutoSize() const {
+		return m_layout.m_autoSize;
+	}
+
+private:
+	// The placement of the layout can be kept if changed images have the same size and no font changed
+	bool isLayoutValid(const AtlasLayout& layout, const std::vector<TileGrid>& imageTiles) const;
+
+	AtlasOptions m_opt;
+	ThreadPool& m_pool;
+
+	std::vector<std::string> m_imageNames;
+	ImageCache m_images;
+	std::vector<bool> m_imageChanged;
+
+#ifndef DISABLE_FREETYPE
+	GlyphCache* m_cache = nullptr;
+	std::vector<FontOptions> m_fontOptions;
+	std::vector<Font> m_fonts;
+	std::vector<bool> m_fontLoaded;
+	std::vector<bool> m_fontChanged;
+#endif
+
+	AtlasLayout m_layout;
+	bool m_layoutReused = false;
+};
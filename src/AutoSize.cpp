@@ -0,0 +1,120 @@
+#include "AutoSize.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "MaxRects.hpp"
+
+struct Candidate {
+	unsigned int m_width;
+	unsigned int m_height;
+};
+
+static std::vector<Candidate> getCandidates(const AutoSizeOptions& opt) {
+	std::vector<Candidate> candidates;
+
+	if (opt.m_powerOfTwo) {
+		for (unsigned int size = 1; size <= opt.m_maxSize; size <<= 1) {
+			if (size > 1)
+				candidates.push_back({ size, size >> 1 });
+
+			candidates.push_back({ size, size });
+		}
+	}
+	else {
+		auto step = std::max(opt.m_align, 1u);
+
+		for (auto size = step; size <= opt.m_maxSize; size += step)
+			candidates.push_back({ size, size });
+	}
+
+	return candidates;
+}
+
+// Returns the number of used bins or zero if the rectangles couldn't be packed
+static unsigned int tryPack(const std::vector<Rectangle>& rects, const Candidate& candidate, const AutoSizeOptions& opt) {
+	MaxRects mr({ candidate.m_width + opt.m_padding, candidate.m_height + opt.m_padding, opt.m_maxBins, opt.m_canFlip });
+
+	std::vector<RectData> data(rects.size());
+
+	for (unsigned int i = 0; i < rects.size(); ++i) {
+		if (!mr.canFit(rects[i].m_w, rects[i].m_h))
+			return 0;
+
+		mr.add(&data[i], rects[i].m_w, rects[i].m_h);
+	}
+
+	return mr.pack() ? mr.getNumBins() : 0;
+}
+
+AutoSizeResult findMinimalSize(const std::vector<Rectangle>& rects, const AutoSizeOptions& opt, ThreadPool& pool) {
+	auto candidates = getCandidates(opt);
+
+	// Skip candidates which are too small for the largest rectangle or the total area
+	unsigned long long area = 0;
+	unsigned int maxW = 0, maxH = 0, minSide = 0, maxSide = 0;
+
+	for (auto& rect : rects) {
+		area += (unsigned long long) rect.m_w * rect.m_h;
+		maxW = std::max(maxW, rect.m_w);
+		maxH = std::max(maxH, rect.m_h);
+		minSide = std::max(minSide, std::min(rect.m_w, rect.m_h));
+		maxSide = std::max(maxSide, std::max(rect.m_w, rect.m_h));
+	}
+
+	candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const Candidate& c) {
+		auto w = c.m_width + opt.m_padding, h = c.m_height + opt.m_padding;
+
+		if (opt.m_canFlip ? (std::max(w, h) < maxSide || std::min(w, h) < minSide) : (w < maxW || h < maxH))
+			return true;
+
+		return (unsigned long long) w * h * std::max(opt.m_maxBins, 1u) < area;
+	}), candidates.end());
+
+	if (candidates.empty())
+		throw std::runtime_error("rectangles don't fit into maximal texture size");
+
+	// Search the first candidate which fits by probing several candidates at once
+	std::vector<unsigned int> bins(candidates.size(), 0);
+
+	unsigned int lo = 0, hi = candidates.size() - 1;
+	bins[hi] = tryPack(rects, candidates[hi], opt);
+
+	if (bins[hi] == 0)
+		throw std::runtime_error("rectangles don't fit into maximal texture size");
+
+	// At least two candidates are probed, so a single thread still halves the range
+	auto numProbes = std::max(pool.size(), 2u);
+
+	while (lo < hi) {
+		std::vector<unsigned int> probes;
+		auto count = std::min(numProbes, hi - lo);
+
+		for (unsigned int i = 0; i < count; ++i)
+			probes.push_back(lo + (unsigned int) ((unsigned long long) (hi - lo) * i / count));
+
+		probes.erase(std::unique(probes.begin(), probes.end()), probes.end());
+
+		pool.parallelFor(probes.size(), [&](unsigned int i) {
+			bins[probes[i]] = tryPack(rects, candidates[probes[i]], opt);
+		});
+
+		auto newLo = lo, newHi = hi;
+
+		for (auto probe : probes)
+			if (bins[probe] != 0)
+				newHi = std::min(newHi, probe);
+
+		for (auto probe : probes)
+			if (bins[probe] == 0 && probe < newHi)
+				newLo = std::max(newLo, probe + 1);
+
+		lo = newLo;
+		hi = newHi;
+	}
+
+	auto& best = candidates[hi];
+	auto binArea = (double) (best.m_width + opt.m_padding) * (best.m_height + opt.m_padding);
+
+	return { best.m_width, best.m_height, bins[hi], area / (binArea * bins[hi]) };
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "Rectangle.hpp"
+#include "ThreadPool.hpp"
+
+struct AutoSizeOptions {
+	unsigned int m_maxSize;
+	unsigned int m_maxBins;
+	unsigned int m_padding; // Added to the size of the bins
+	unsigned int m_align;
+	bool m_powerOfTwo;
+	bool m_canFlip;
+};
+
+struct AutoSizeResult {
+	unsigned int m_width;
+	unsigned int m_height;
+	unsigned int m_numBins;
+	double m_occupancy;
+};
+
+// Searches the smallest texture size which fits all rectangles into the maximal number of bins.
+// Only the size of the rectangles is used. Trial packs are run concurrently on the pool.
+AutoSizeResult findMinimalSize(const std::vector<Rectangle>& rects, const AutoSizeOptions& opt, ThreadPool& pool);
@@ -0,0 +1,106 @@
+#include "BuildCache.hpp"
+
+#include <algorithm>
+
+#include "Dedup.hpp"
+#include "Platform.hpp"
+
+unsigned long long BuildCache::hashFile(const std::string& file) {
+	MappedFile map(file);
+	return hashBytes(map.data(), map.size());
+}
+
+void BuildCache::addImage(AtlasBuilder& builder, const std::string& name, const std::string& file) {
+	auto hash = hashFile(file);
+	auto& cached = m_images[file];
+
+	++m_stats.m_images;
+
+	if (cached.m_loaded && cached.m_hash == hash)
+		++m_stats.m_reusedImages;
+	else {
+		cached.m_loaded = false;
+		cached.m_img = Image::load(file);
+		cached.m_hash = hash;
+		cached.m_loaded = true;
+	}
+
+	cached.m_used = true;
+	builder.addImage(name, cached.m_img);
+}
+
+#ifndef DISABLE_FREETYPE
+bool BuildCache::isSameRendering(const FontOptions& a, const FontOptions& b) {
+	// The name and the color are only used when the atlas is composed
+	if (a.m_file != b.m_file || a.m_size != b.m_size || a.m_distantFieldSize != b.m_distantFieldSize ||
+		a.m_distantFieldSpread != b.m_distantFieldSpread || a.m_multiChannel != b.m_multiChannel ||
+		a.m_kerning != b.m_kerning || a.m_ranges.size() != b.m_ranges.size())
+		return false;
+
+	for (unsigned int i = 0; i < a.m_ranges.size(); ++i)
+		if (a.m_ranges[i].m_beg != b.m_ranges[i].m_beg || a.m_ranges[i].m_end != b.m_ranges[i].m_end)
+			return false;
+
+	return true;
+}
+
+void BuildCache::addFont(AtlasBuilder& builder, const FontOptions& font) {
+	auto hash = hashFile(font.m_file);
+
+	++m_stats.m_fonts;
+
+	for (auto& cached : m_fonts) {
+		if (cached.m_hash == hash && isSameRendering(cached.m_options, font)) {
+			++m_stats.m_reusedFonts;
+			cached.m_used = true;
+			builder.addFont(font, cached.m_font);
+			return;
+		}
+	}
+
+	m_pending.push_back({ builder.getNumFonts(), font, hash });
+	builder.addFont(font);
+}
+#endif
+
+BuildCache::Stats BuildCache::commit(const AtlasBuilder& builder) {
+	for (auto it = m_images.begin(); it != m_images.end();) {
+		if (it->second.m_used)
+			(it++)->second.m_used = false;
+		else
+			it = m_images.erase(it);
+	}
+
+#ifndef DISABLE_FREETYPE
+	m_fonts.erase(std::remove_if(m_fonts.begin(), m_fonts.end(), [](const CachedFont& font) { return !font.m_used; }), m_fonts.end());
+
+	for (auto& font : m_fonts)
+		font.m_used = false;
+
+	// Fonts aren't kept if the build failed
+	for (auto& pending : m_pending)
+		if (pending.m_index < builder.getNumFonts() && builder.isFontLoaded(pending.m_index))
+			m_fonts.push_back({ pending.m_options, pending.m_hash, builder.getFont(pending.m_index), false });
+
+	m_pending.clear();
+#endif
+
+	auto stats = m_stats;
+	m_stats = Stats();
+
+	return stats;
+}
+
+void BuildCache::abort() {
+	for (auto& image : m_images)
+		image.second.m_used = false;
+
+#ifndef DISABLE_FREETYPE
+	for (auto& font : m_fonts)
+		font.m_used = false;
+
+	m_pending.clear();
+#endif
+
+	m_stats = Stats();
+}
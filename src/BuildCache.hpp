@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AtlasBuilder.hpp"
+
+// Keeps decoded images and rendered fonts between builds (e.g. of a server). Files are compared by their
+// contents, so images and fonts are only loaded again if they changed.
+class BuildCache {
+public:
+	struct Stats {
+		unsigned int m_images = 0;
+		unsigned int m_reusedImages = 0;
+		unsigned int m_fonts = 0;
+		unsigned int m_reusedFonts = 0;
+	};
+
+	// Adds the image of the file to the builder
+	void addImage(AtlasBuilder& builder, const std::string& name, const std::string& file);
+
+#ifndef DISABLE_FREETYPE
+	// Adds the rendered font to the builder, it's rendered by the builder if it isn't cached
+	void addFont(AtlasBuilder& builder, const FontOptions& font);
+#endif
+
+	// Keeps the fonts which were rendered by the (built) builder and drops everything which wasn't used since
+	// the last call. Returns what was reused since the last call.
+	Stats commit(const AtlasBuilder& builder);
+
+	// Forgets the current build (e.g. if it failed) without dropping anything
+	void abort();
+
+private:
+	struct CachedImage {
+		unsigned long long m_hash = 0;
+		Image m_img = Image(0, 0);
+		bool m_loaded = false;
+		bool m_used = false;
+	};
+
+#ifndef DISABLE_FREETYPE
+	struct CachedFont {
+		FontOptions m_options;
+		unsigned long long m_hash;
+		Font m_font;
+		bool m_used;
+	};
+
+	// Fonts which are rendered by the builder and their index in it
+	struct PendingFont {
+		unsigned int m_index;
+		FontOptions m_options;
+		unsigned long long m_hash;
+	};
+
+	static bool isSameRendering(const FontOptions& a, const FontOptions& b);
+#endif
+
+	static unsigned long long hashFile(const std::string& file);
+
+	std::map<std::string, CachedImage> m_images;
+
+#ifndef DISABLE_FREETYPE
+	std::vector<CachedFont> m_fonts;
+	std::vector<PendingFont> m_pending;
+#endif
+
+	Stats m_stats;
+};
@@ -1,111 +1,188 @@
 #include "Canvas.hpp"
 
 #include <algorithm>
+#include <cassert>
+#include <cstring>
 
-Canvas::Canvas(unsigned int width, unsigned int height): m_img(width, height) { }
+template<typename Pixel> const unsigned int BasicCanvas<Pixel>::TileSize;
 
-void Canvas::draw(const Image& img, unsigned int x, unsigned int y, bool flip, unsigned int expand) {
+template<typename Pixel> BasicCanvas<Pixel>::BasicCanvas(unsigned int width, unsigned int height):
+	m_width(width), m_height(height),
+	m_tilesX((width + TileSize - 1) / TileSize), m_tilesY((height + TileSize - 1) / TileSize),
+	m_tiles(m_tilesX * m_tilesY) { }
+
+template<typename Pixel> void BasicCanvas<Pixel>::draw(const ImageType& img, unsigned int x, unsigned int y, bool flip, unsigned int expand) {
 	auto width = img.width(), height = img.height();
 
 	if (width == 0 || height == 0)
 		return;
 
+	if (expand == 0 && !flip) {
+		blit(img, x, y);
+		return;
+	}
+
+	// Draw the rotated and expanded image first, so it can be copied into the tiles
+	ImageType sprite(flip ? height + expand : width + expand, flip ? width + expand : height + expand);
+
 	if (expand > 0) {
 		auto padding = expand >> 1;
 		auto otherPadding = expand - padding;
 
 		if (flip) {
-			m_img.copyFlipped(img, 0, 0, width, height, x + padding, y + padding);
+			sprite.copyFlipped(img, 0, 0, width, height, padding, padding);
 
 			for (unsigned int i = 0; i < padding; ++i) {
-				m_img.copyLineHorFlipped(img, 0, 0, height, x + padding, y + i);
-				m_img.copyLineVertFlipped(img, 0, 0, width, x + i, y + padding);
+				sprite.copyLineHorFlipped(img, 0, 0, height, padding, i);
+				sprite.copyLineVertFlipped(img, 0, 0, width, i, padding);
 			}
 
 			for (unsigned int i = 0; i < otherPadding; ++i) {
-				m_img.copyLineHorFlipped(img, 0, width - 1, height, x + padding, y + padding + width + i);
-				m_img.copyLineVertFlipped(img, height - 1, 0, width, x + padding + height + i, y + padding);
+				sprite.copyLineHorFlipped(img, 0, width - 1, height, padding, padding + width + i);
+				sprite.copyLineVertFlipped(img, height - 1, 0, width, padding + height + i, padding);
 			}
 
-			m_img.fill(x, y, padding, padding, img.atFlipped(0, 0));
-			m_img.fill(x + padding + height, y, otherPadding, padding, img.atFlipped(height - 1, 0));
-			m_img.fill(x + padding + height, y + padding + width, otherPadding, otherPadding, img.atFlipped(height - 1, width - 1));
-			m_img.fill(x, y + padding + width, padding, otherPadding, img.atFlipped(0, width - 1));
+			sprite.fill(0, 0, padding, padding, img.atFlipped(0, 0));
+			sprite.fill(padding + height, 0, otherPadding, padding, img.atFlipped(height - 1, 0));
+			sprite.fill(padding + height, padding + width, otherPadding, otherPadding, img.atFlipped(height - 1, width - 1));
+			sprite.fill(0, padding + width, padding, otherPadding, img.atFlipped(0, width - 1));
 		}
 		else {
-			m_img.copy(img, 0, 0, width, height, x + padding, y + padding);
+			sprite.copy(img, 0, 0, width, height, padding, padding);
 
 			for (unsigned int i = 0; i < padding; ++i) {
-				m_img.copyLineHor(img, 0, 0, width, x + padding, y + i);
-				m_img.copyLineVert(img, 0, 0, height, x + i, y + padding);
+				sprite.copyLineHor(img, 0, 0, width, padding, i);
+				sprite.copyLineVert(img, 0, 0, height, i, padding);
 			}
 
 			for (unsigned int i = 0; i < otherPadding; ++i) {
-				m_img.copyLineHor(img, 0, height - 1, width, x + padding, y + padding + height + i);
-				m_img.copyLineVert(img, width - 1, 0, height, x + padding + width + i, y + padding);
+				sprite.copyLineHor(img, 0, height - 1, width, padding, padding + height + i);
+				sprite.copyLineVert(img, width - 1, 0, height, padding + width + i, padding);
 			}
 
-			m_img.fill(x, y, padding, padding, img.at(0, 0));
-			m_img.fill(x + padding + width, y, otherPadding, padding, img.at(width - 1, 0));
-			m_img.fill(x + padding + width, y + padding + height, otherPadding, otherPadding, img.at(width - 1, height - 1));
-			m_img.fill(x, y + padding + height, padding, otherPadding, img.at(0, height - 1));
+			sprite.fill(0, 0, padding, padding, img.at(0, 0));
+			sprite.fill(padding + width, 0, otherPadding, padding, img.at(width - 1, 0));
+			sprite.fill(padding + width, padding + height, otherPadding, otherPadding, img.at(width - 1, height - 1));
+			sprite.fill(0, padding + height, padding, otherPadding, img.at(0, height - 1));
 		}
 	}
-	else if (flip)
-		m_img.copyFlipped(img, 0, 0, width, height, x, y);
 	else
-		m_img.copy(img, 0, 0, width, height, x, y);
-}
+		sprite.copyFlipped(img, 0, 0, width, height, 0, 0);
 
-void Canvas::drawRect(const Image& img, const Rectangle& rect, unsigned int x, unsigned int y, bool flip, unsigned int expand) {
-	auto width = rect.m_w, height = rect.m_h;
+	blit(sprite, x, y);
+}
 
-	if (width == 0 || height == 0)
+template<typename Pixel> void BasicCanvas<Pixel>::drawRect(const ImageType& img, const Rectangle& rect, unsigned int x, unsigned int y, bool flip, unsigned int expand) {
+	if (rect.m_w == 0 || rect.m_h == 0)
 		return;
 
-	if (expand > 0) {
-		auto padding = expand >> 1;
-		auto otherPadding = expand - padding;
+	ImageType part(rect.m_w, rect.m_h);
+	part.copy(img, rect.m_x, rect.m_y, rect.m_w, rect.m_h, 0, 0);
 
-		if (flip) {
-			m_img.copyFlipped(img, rect.m_x, rect.m_y, width, height, x + padding, y + padding);
+	draw(part, x, y, flip, expand);
+}
 
-			for (unsigned int i = 0; i < padding; ++i) {
-				m_img.copyLineHorFlipped(img, rect.m_x, rect.m_y, height, x + padding, y + i);
-				m_img.copyLineVertFlipped(img, rect.m_x, rect.m_y, width, x + i, y + padding);
-			}
+template<typename Pixel> typename BasicCanvas<Pixel>::ImageType BasicCanvas<Pixel>::getImage() const {
+	ImageType img(m_width, m_height);
 
-			for (unsigned int i = 0; i < otherPadding; ++i) {
-				m_img.copyLineHorFlipped(img, rect.m_x, rect.m_y + width - 1, height, x + padding, y + padding + width + i);
-				m_img.copyLineVertFlipped(img, rect.m_x + height - 1, rect.m_y, width, x + padding + height + i, y + padding);
-			}
+	for (unsigned int ty = 0; ty < m_tilesY; ++ty) {
+		for (unsigned int tx = 0; tx < m_tilesX; ++tx) {
+			auto& tile = m_tiles[ty * m_tilesX + tx];
+
+			if (!tile)
+				continue;
 
-			m_img.fill(x, y, padding, padding, img.atFlipped(rect.m_x, rect.m_y));
-			m_img.fill(x + padding + height, y, otherPadding, padding, img.atFlipped(rect.m_x + height - 1, rect.m_y));
-			m_img.fill(x + padding + height, y + padding + width, otherPadding, otherPadding, img.atFlipped(rect.m_x + height - 1, rect.m_y + width - 1));
-			m_img.fill(x, y + padding + width, padding, otherPadding, img.atFlipped(rect.m_x, rect.m_y + width - 1));
+			auto w = std::min(TileSize, m_width - tx * TileSize);
+			auto h = std::min(TileSize, m_height - ty * TileSize);
+
+			for (unsigned int j = 0; j < h; ++j)
+				memcpy(&img.at(tx * TileSize, ty * TileSize + j), &tile[j * TileSize], w * sizeof(Pixel));
 		}
-		else {
-			m_img.copy(img, rect.m_x, rect.m_y, width, height, x + padding, y + padding);
+	}
 
-			for (unsigned int i = 0; i < padding; ++i) {
-				m_img.copyLineHor(img, rect.m_x, rect.m_y, width, x + padding, y + i);
-				m_img.copyLineVert(img, rect.m_x, rect.m_y, height, x + i, y + padding);
-			}
+	return img;
+}
 
-			for (unsigned int i = 0; i < otherPadding; ++i) {
-				m_img.copyLineHor(img, rect.m_x, rect.m_y + height - 1, width, x + padding, y + padding + height + i);
-				m_img.copyLineVert(img, rect.m_x + width - 1, rect.m_y, height, x + padding + width + i, y + padding);
-			}
+template<typename Pixel> void BasicCanvas<Pixel>::save(const std::string& file) const {
+	// Rows without allocated tiles all point to the same transparent row
+	std::vector<Pixel> emptyRow(m_width), row(m_width);
+
+	ImageType::save(file, m_width, m_height, [&](unsigned int y) -> const Pixel* {
+		return readRow(y, row.data()) ? row.data() : emptyRow.data();
+	});
+}
+
+template<typename Pixel> bool BasicCanvas<Pixel>::readRow(unsigned int y, Pixel* row) const {
+	auto ty = y / TileSize;
+	auto tiles = &m_tiles[ty * m_tilesX];
+
+	if (std::none_of(tiles, tiles + m_tilesX, [](auto& tile) { return (bool) tile; }))
+		return false;
+
+	for (unsigned int tx = 0; tx < m_tilesX; ++tx) {
+		auto w = std::min(TileSize, m_width - tx * TileSize);
+
+		if (tiles[tx])
+			memcpy(&row[tx * TileSize], &tiles[tx][(y % TileSize) * TileSize], w * sizeof(Pixel));
+		else
+			memset(&row[tx * TileSize], 0, w * sizeof(Pixel));
+	}
+
+	return true;
+}
+
+template<typename Pixel> Pixel* BasicCanvas<Pixel>::getTile(unsigned int tx, unsigned int ty) {
+	auto& tile = m_tiles[ty * m_tilesX + tx];
+
+	if (!tile) {
+		tile.reset(new Pixel[TileSize * TileSize]());
+		++m_numAllocated;
+	}
+
+	return tile.get();
+}
+
+template<typename Pixel> void BasicCanvas<Pixel>::blit(const ImageType& img, unsigned int x, unsigned int y) {
+	assert(x + img.width() <= m_width);
+	assert(y + img.height() <= m_height);
 
-			m_img.fill(x, y, padding, padding, img.at(rect.m_x, rect.m_y));
-			m_img.fill(x + padding + width, y, otherPadding, padding, img.at(rect.m_x + width - 1, rect.m_y));
-			m_img.fill(x + padding + width, y + padding + height, otherPadding, otherPadding, img.at(rect.m_x + width - 1, rect.m_y + height - 1));
-			m_img.fill(x, y + padding + height, padding, otherPadding, img.at(rect.m_x, rect.m_y + height - 1));
+	for (auto ty = y / TileSize; ty <= (y + img.height() - 1) / TileSize; ++ty) {
+		auto y1 = std::max(y, ty * TileSize);
+		auto y2 = std::min(y + img.height(), (ty + 1) * TileSize);
+
+		for (auto tx = x / TileSize; tx <= (x + img.width() - 1) / TileSize; ++tx) {
+			auto x1 = std::max(x, tx * TileSize);
+			auto x2 = std::min(x + img.width(), (tx + 1) * TileSize);
+
+			auto tile = getTile(tx, ty);
+
+			for (auto j = y1; j < y2; ++j)
+				memcpy(&tile[(j - ty * TileSize) * TileSize + (x1 - tx * TileSize)], &img.at(x1 - x, j - y), (x2 - x1) * sizeof(Pixel));
 		}
 	}
-	else if (flip)
-		m_img.copyFlipped(img, rect.m_x, rect.m_y, width, height, x, y);
-	else
-		m_img.copy(img, rect.m_x, rect.m_y, width, height, x, y);
+}
+
+template class BasicCanvas<unsigned int>;
+template class BasicCanvas<unsigned char>;
+
+void saveChannels(const std::string& file, const GrayCanvas* channels, unsigned int count) {
+	assert(count > 0 && count <= 4);
+
+	auto width = channels[0].width(), height = channels[0].height();
+	std::vector<unsigned char> row(width);
+	std::vector<unsigned int> pixels(width);
+
+	Image::save(file, width, height, [&](unsigned int y) -> const unsigned int* {
+		std::fill(pixels.begin(), pixels.end(), 0);
+
+		for (unsigned int c = 0; c < count; ++c) {
+			assert(channels[c].width() == width && channels[c].height() == height);
+
+			if (channels[c].readRow(y, row.data()))
+				for (unsigned int x = 0; x < width; ++x)
+					pixels[x] |= (unsigned int) row[x] << (c * 8);
+		}
+
+		return pixels.data();
+	});
 }
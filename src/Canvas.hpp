@@ -1,18 +1,54 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "Image.hpp"
 
-class Canvas {
+// Canvas which is split into tiles, tiles are only allocated when something is drawn onto them
+template<typename Pixel> class BasicCanvas {
 public:
-	Canvas(unsigned int width, unsigned int height);
+	typedef BasicImage<Pixel> ImageType;
+
+	BasicCanvas(unsigned int width, unsigned int height);
+
+	void draw(const ImageType& img, unsigned int x, unsigned int y, bool flip, unsigned int expand);
+	void drawRect(const ImageType& img, const Rectangle& rect, unsigned int x, unsigned int y, bool flip, unsigned int expand);
 
-	void draw(const Image& img, unsigned int x, unsigned int y, bool flip, unsigned int expand);
-	void drawRect(const Image& img, const Rectangle& rect, unsigned int x, unsigned int y, bool flip, unsigned int expand);
+	inline unsigned int width() const {
+		return m_width;
+	}
+
+	inline unsigned int height() const {
+		return m_height;
+	}
 
-	inline const Image& getImage() const {
-		return m_img;
+	inline unsigned int getNumAllocatedTiles() const {
+		return m_numAllocated;
 	}
 
+	ImageType getImage() const;
+	void save(const std::string& file) const;
+
+	// Copies a row of pixels, returns false (without writing) if none of the tiles of the row is allocated
+	bool readRow(unsigned int y, Pixel* row) const;
+
 private:
-	Image m_img;
+	static const unsigned int TileSize = 64;
+
+	void blit(const ImageType& img, unsigned int x, unsigned int y);
+	Pixel* getTile(unsigned int tx, unsigned int ty);
+
+	unsigned int m_width;
+	unsigned int m_height;
+	unsigned int m_tilesX;
+	unsigned int m_tilesY;
+	unsigned int m_numAllocated = 0;
+	std::vector<std::unique_ptr<Pixel[]>> m_tiles;
 };
+
+typedef BasicCanvas<unsigned int> Canvas;
+typedef BasicCanvas<unsigned char> GrayCanvas;
+
+// Saves up to four canvases of the same size as the channels of a single RGBA image
+void saveChannels(const std::string& file, const GrayCanvas* channels, unsigned int count);
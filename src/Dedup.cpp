@@ -0,0 +1,57 @@
+#include "Dedup.hpp"
+
+#include <cstring>
+#include <unordered_map>
+
+static inline unsigned long long mix(unsigned long long value) {
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDull;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+unsigned long long hashBytes(const void* data, std::size_t size, unsigned long long seed) {
+	auto bytes = (const unsigned char*) data;
+	auto hash = mix(seed ^ (size * 0x9E3779B97F4A7C15ull));
+
+	// Eight bytes at a time, the rest is padded with zeros
+	for (; size >= 8; bytes += 8, size -= 8) {
+		unsigned long long word;
+		memcpy(&word, bytes, 8);
+		hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ull;
+	}
+
+	if (size > 0) {
+		unsigned long long word = 0;
+		memcpy(&word, bytes, size);
+		hash = (hash ^ mix(word)) * 0x9E3779B97F4A7C15ull;
+	}
+
+	return mix(hash);
+}
+
+std::vector<unsigned int> findDuplicates(unsigned int count, const std::function<unsigned long long(unsigned int)>& hash, const std::function<bool(unsigned int, unsigned int)>& equal) {
+	std::vector<unsigned int> sources(count);
+	std::unordered_multimap<unsigned long long, unsigned int> unique;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		auto h = hash(i);
+		auto range = unique.equal_range(h);
+
+		sources[i] = i;
+
+		for (auto it = range.first; it != range.second; ++it) {
+			if (equal(it->second, i)) {
+				sources[i] = it->second;
+				break;
+			}
+		}
+
+		if (sources[i] == i)
+			unique.emplace(h, i);
+	}
+
+	return sources;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Fast 64 bit hash of a block of memory (not suitable for cryptography)
+unsigned long long hashBytes(const void* data, std::size_t size, unsigned long long seed = 0);
+
+// Returns the index of the first identical item for every item (its own index if there is none).
+// Items with the same hash are compared with equal, so collisions don't merge different items.
+std::vector<unsigned int> findDuplicates(unsigned int count, const std::function<unsigned long long(unsigned int)>& hash, const std::function<bool(unsigned int, unsigned int)>& equal);
@@ -2,82 +2,197 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <limits>
 
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
+#include "ThreadPool.hpp"
 #include "Utils.hpp"
 
-static bool isInside(unsigned int color) {
-	return (color & 0x80000000) != 0;
+static const double infinity = 1e20;
+
+// Column distance of cells without a site in their column
+static const int noSite = 1 << 30;
+
+static bool isInside(unsigned char value) {
+	return (value & 0x80) != 0;
 }
 
-static inline int clamp(int val, int min, int max) {
-	return std::max(std::min(val, max), min);
+// One dimensional squared euclidean distance transform (Felzenszwalb and Huttenlocher)
+static void distanceTransform(const double* f, double* d, unsigned int n, unsigned int* v, double* z) {
+	unsigned int k = 0;
+
+	v[0] = 0;
+	z[0] = -std::numeric_limits<double>::infinity();
+	z[1] = std::numeric_limits<double>::infinity();
+
+	for (unsigned int q = 1; q < n; ++q) {
+		auto s = ((f[q] + (double) q * q) - (f[v[k]] + (double) v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+
+		while (s <= z[k]) {
+			--k;
+			s = ((f[q] + (double) q * q) - (f[v[k]] + (double) v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+		}
+
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = std::numeric_limits<double>::infinity();
+	}
+
+	k = 0;
+
+	for (unsigned int q = 0; q < n; ++q) {
+		while (z[k + 1] < q)
+			++k;
+
+		auto r = v[k];
+		d[q] = ((double) q - r) * ((double) q - r) + f[r];
+	}
 }
 
-static inline void distMin(int& minDist, int dx, int dy) {
-	const auto dist = dx * dx + dy * dy;
+// Calls func with ranges of [0, count). Large grids are split into several ranges which run on the pool.
+static void forRanges(ThreadPool* pool, unsigned int count, unsigned int cells, const std::function<void(unsigned int, unsigned int)>& func) {
+	const unsigned int minCells = 1 << 16;
+
+	auto numRanges = pool && cells >= minCells ? std::min(count, pool->size() * 4) : 1;
+
+	if (numRanges <= 1) {
+		func(0, count);
+		return;
+	}
 
-	if (dist < minDist)
-		minDist = dist;
+	pool->parallelFor(numRanges, [&](unsigned int i) {
+		func(count * i / numRanges, count * (i + 1) / numRanges);
+	});
 }
 
-static float findSignedDistance(const std::vector<bool>& map, int x, int y, int w, int h, float spread) {
-	auto ins = (x < 0 || x >= w || y < 0 || y >= h) ? false : map[y * w + x];
+// dst[x] = mask[x] == site ? 0 : prev[x] + 1
+static void sweepRow(const unsigned char* mask, unsigned char site, const int* prev, int* dst, unsigned int n) {
+	unsigned int x = 0;
+
+#ifdef __AVX2__
+	const auto one = _mm256_set1_epi32(1);
+	const auto max = _mm256_set1_epi32(noSite);
+	const auto sites = _mm256_set1_epi32(site);
+
+	for (; x + 8 <= n; x += 8) {
+		auto m = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (mask + x)));
+		auto d = _mm256_min_epi32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (prev + x)), one), max);
+
+		_mm256_storeu_si256((__m256i*) (dst + x), _mm256_andnot_si256(_mm256_cmpeq_epi32(m, sites), d));
+	}
+#endif
 
-	auto delta = (int) std::ceil(spread);
+	for (; x < n; ++x)
+		dst[x] = mask[x] == site ? 0 : std::min(prev[x] + 1, noSite);
+}
 
-	auto startX = clamp(x - delta, 0, w - 1);
-	auto endX   = clamp(x + delta, 0, w - 1);
-	auto startY = clamp(y - delta, 0, h - 1);
-	auto endY   = clamp(y + delta, 0, h - 1);
+// dst[x] = min(dst[x], next[x] + 1)
+static void mergeRow(const int* next, int* dst, unsigned int n) {
+	unsigned int x = 0;
 
-	auto minDist = delta * delta;
+#ifdef __AVX2__
+	const auto one = _mm256_set1_epi32(1);
 
-	if (ins) {
-		distMin(minDist, x + 1, 0);
-		distMin(minDist, w - x, 0);
-		distMin(minDist, y + 1, 0);
-		distMin(minDist, h - y, 0);
+	for (; x + 8 <= n; x += 8) {
+		auto d = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (next + x)), one);
+		_mm256_storeu_si256((__m256i*) (dst + x), _mm256_min_epi32(_mm256_loadu_si256((const __m256i*) (dst + x)), d));
 	}
+#endif
+
+	for (; x < n; ++x)
+		dst[x] = std::min(dst[x], next[x] + 1);
+}
+
+// Squared euclidean distance to the nearest cell of the mask which equals site, clamped to maxDist.
+// The vertical distances are swept over whole rows, then every row is transformed separately.
+static void distanceTransform(const std::vector<unsigned char>& mask, unsigned char site, std::vector<int>& grid,
+	unsigned int w, unsigned int h, int maxDist, ThreadPool* pool) {
+
+	grid.resize(w * h);
+
+	forRanges(pool, w, w * h, [&](unsigned int beg, unsigned int end) {
+		std::vector<int> none(end - beg, noSite);
+
+		sweepRow(&mask[beg], site, none.data(), &grid[beg], end - beg);
+
+		for (unsigned int y = 1; y < h; ++y)
+			sweepRow(&mask[y * w + beg], site, &grid[(y - 1) * w + beg], &grid[y * w + beg], end - beg);
+
+		for (auto y = (int) h - 2; y >= 0; --y)
+			mergeRow(&grid[(y + 1) * w + beg], &grid[y * w + beg], end - beg);
+	});
+
+	forRanges(pool, h, w * h, [&](unsigned int beg, unsigned int end) {
+		std::vector<double> f(w), d(w), z(w + 1);
+		std::vector<unsigned int> v(w);
 
-	for (auto j = startY; j <= endY; ++j)
-		for (auto i = startX; i <= endX; ++i)
-			if (ins != map[j * w + i])
-				distMin(minDist, x - i, y - j);
+		for (auto y = beg; y < end; ++y) {
+			auto row = &grid[y * w];
 
-	auto dist = std::min(std::sqrt((float) minDist), spread) / spread;
-	return ins ? dist : -dist;
+			for (unsigned int x = 0; x < w; ++x)
+				f[x] = row[x] >= noSite ? infinity : (double) row[x] * row[x];
+
+			distanceTransform(f.data(), d.data(), w, v.data(), z.data());
+
+			for (unsigned int x = 0; x < w; ++x)
+				row[x] = (int) std::min(d[x], (double) maxDist);
+		}
+	});
 }
 
-static unsigned int distanceToRGB(float dist) {
+static unsigned char distanceToValue(float dist) {
 	auto v = std::max(std::min(0.5f + 0.5f * dist, 1.0f), 0.0f);
-	auto vc = (unsigned char) (v * 0xFF);
-	return makeRBGA(vc, vc, vc, 0xFF);
+	return (unsigned char) (v * 0xFF);
 }
 
-Image distantFieldFromImage(const Image& src, unsigned int spread, unsigned int downscale) {
+GrayImage distantFieldFromImage(const GrayImage& src, unsigned int spread, unsigned int downscale, ThreadPool* pool) {
 	if (src.empty())
 		return src;
 
 	auto padding = spread / downscale;
 
-	Image img(src.width() / downscale + 2 * padding, src.height() / downscale + 2 * padding);
+	GrayImage img(src.width() / downscale + 2 * padding, src.height() / downscale + 2 * padding);
+
+	// The distances are computed on a grid which has a border, so samples outside of the image can be looked up
+	// and the nearest outside pixel of an inside pixel at the edge is the border
+	auto border = (int) spread + 1;
+	auto gridW = src.width() + 2 * border;
+	auto gridH = src.height() + 2 * border;
+
+	std::vector<unsigned char> mask(gridW * gridH, 0);
 
-	std::vector<bool> map;
-	map.reserve(src.width() * src.height());
+	for (unsigned int y = 0; y < src.height(); ++y)
+		for (unsigned int x = 0; x < src.width(); ++x)
+			mask[(y + border) * gridW + x + border] = isInside(src.at(x, y)) ? 1 : 0;
 
-	for (unsigned int i = 0; i < src.width() * src.height(); ++i)
-		map.push_back(isInside(src.data()[i]));
+	const auto delta = (int) std::ceil((float) spread);
 
-	for (int j = 0; j < (int) img.height(); ++j) {
-		for (int i = 0; i < (int) img.width(); ++i) {
-			auto x = ((i - padding) * downscale) + (downscale / 2);
-			auto y = ((j - padding) * downscale) + (downscale / 2);
-			
-			img.at(i, j) = distanceToRGB(
-				findSignedDistance(map, x, y, src.width(), src.height(), (float) spread)
-			);
+	std::vector<int> toInside, toOutside;
+	distanceTransform(mask, 1, toInside, gridW, gridH, delta * delta, pool);
+	distanceTransform(mask, 0, toOutside, gridW, gridH, delta * delta, pool);
+
+	forRanges(pool, img.height(), gridW * gridH, [&](unsigned int beg, unsigned int end) {
+		for (auto j = (int) beg; j < (int) end; ++j) {
+			for (int i = 0; i < (int) img.width(); ++i) {
+				auto x = ((i - (int) padding) * (int) downscale) + (int) (downscale / 2);
+				auto y = ((j - (int) padding) * (int) downscale) + (int) (downscale / 2);
+
+				// Samples are always inside of the grid
+				auto ind = (unsigned int) (y + border) * gridW + (unsigned int) (x + border);
+				auto ins = mask[ind] != 0;
+
+				auto minDist = ins ? toOutside[ind] : toInside[ind];
+				auto dist = std::min(std::sqrt((float) minDist), (float) spread) / (float) spread;
+
+				img.at(i, j) = distanceToValue(ins ? dist : -dist);
+			}
 		}
-	}
+	});
 
 	return img;
 }
@@ -2,4 +2,7 @@
 
 #include <Image.hpp>
 
-Image distantFieldFromImage(const Image& src, unsigned int spread, unsigned int downscale);
+class ThreadPool;
+
+// Pixels with a value of at least 128 are inside. Large images are split into row ranges which are processed on the pool (if given)
+GrayImage distantFieldFromImage(const GrayImage& src, unsigned int spread, unsigned int downscale, ThreadPool* pool = nullptr);
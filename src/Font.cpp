@@ -1,35 +1,161 @@
 #ifndef DISABLE_FREETYPE
 #include "Font.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <freetype/ftoutln.h>
+#include <freetype/tttables.h>
+#include <freetype/tttags.h>
+
+#include "DistantField.hpp"
+#include "GlyphCache.hpp"
+#include "MultiDistantField.hpp"
+#include "ThreadPool.hpp"
 #include "Utils.hpp"
 
-static Image imageFromSlot(const FT_GlyphSlot slot, unsigned int color) {
+// Maximal distance between a curve and its polyline in pixels
+static const double flatness = 0.05;
+
+static GrayImage imageFromSlot(const FT_GlyphSlot slot) {
 	if (slot->bitmap.width != 0 && slot->bitmap.rows != 0) {
-		Image img(slot->bitmap.width, slot->bitmap.rows);
+		GrayImage img(slot->bitmap.width, slot->bitmap.rows);
 
-		for (unsigned int j = 0; j < img.width() * img.height(); ++j)
-			img.data()[j] = slot->bitmap.buffer[j] << 24 | color;
+		// Rows of the bitmap can be padded
+		for (unsigned int j = 0; j < img.height(); ++j)
+			memcpy(&img.at(0, j), slot->bitmap.buffer + j * slot->bitmap.pitch, img.width());
 
 		return img;
 	}
 
-	return Image(0, 0);
+	return GrayImage(0, 0);
 }
 
-FreeType::FreeType() {
-	if (FT_Init_FreeType(&m_lib) != FT_Err_Ok)
-		throw std::runtime_error("failed to initalize FreeType");
+static Vector2 toVector(const FT_Vector* vec) {
+	return { vec->x / 64.0, vec->y / 64.0 };
 }
 
-FreeType::~FreeType() {
-	if (m_lib)
-		FT_Done_FreeType(m_lib);
+struct OutlineContext {
+	Shape* m_shape;
+	Vector2 m_pos;
+
+	void addEdge(Edge edge) {
+		auto start = m_pos;
+		m_pos = edge.m_points.back();
+
+		// Skip edges without length
+		for (auto& point : edge.m_points) {
+			if (point.m_x != start.m_x || point.m_y != start.m_y) {
+				m_shape->m_contours.back().m_edges.push_back(std::move(edge));
+				break;
+			}
+		}
+	}
+};
+
+static unsigned int getNumSegments(Vector2 a, Vector2 b, Vector2 c) {
+	auto dx = a.m_x - 2 * b.m_x + c.m_x, dy = a.m_y - 2 * b.m_y + c.m_y;
+	auto n = (unsigned int) std::ceil(std::sqrt(std::sqrt(dx * dx + dy * dy) / (4 * flatness)));
+
+	return std::min(std::max(n, 1u), 64u);
 }
 
-Font FreeType::load(const std::string& file, unsigned int size, unsigned int color, const std::vector<Range>& ranges) {
+static Shape shapeFromOutline(FT_Outline& outline) {
+	Shape shape;
+	OutlineContext ctx { &shape, { 0, 0 } };
+
+	FT_Outline_Funcs funcs;
+
+	funcs.move_to = [](const FT_Vector* to, void* user) {
+		auto& ctx = *(OutlineContext*) user;
+		ctx.m_shape->m_contours.emplace_back();
+		ctx.m_pos = toVector(to);
+		return 0;
+	};
+
+	funcs.line_to = [](const FT_Vector* to, void* user) {
+		auto& ctx = *(OutlineContext*) user;
+
+		Edge edge;
+		edge.m_points = { ctx.m_pos, toVector(to) };
+
+		ctx.addEdge(std::move(edge));
+		return 0;
+	};
+
+	funcs.conic_to = [](const FT_Vector* control, const FT_Vector* to, void* user) {
+		auto& ctx = *(OutlineContext*) user;
+		auto p0 = ctx.m_pos, p1 = toVector(control), p2 = toVector(to);
+		auto n = getNumSegments(p0, p1, p2);
+
+		Edge edge;
+
+		for (unsigned int i = 0; i <= n; ++i) {
+			auto t = (double) i / n, s = 1 - t;
+			edge.m_points.push_back({
+				s * s * p0.m_x + 2 * s * t * p1.m_x + t * t * p2.m_x,
+				s * s * p0.m_y + 2 * s * t * p1.m_y + t * t * p2.m_y
+			});
+		}
+
+		ctx.addEdge(std::move(edge));
+		return 0;
+	};
+
+	funcs.cubic_to = [](const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user) {
+		auto& ctx = *(OutlineContext*) user;
+		auto p0 = ctx.m_pos, p1 = toVector(control1), p2 = toVector(control2), p3 = toVector(to);
+		auto n = std::max(getNumSegments(p0, p1, p2), getNumSegments(p1, p2, p3));
+
+		Edge edge;
+
+		for (unsigned int i = 0; i <= n; ++i) {
+			auto t = (double) i / n, s = 1 - t;
+			edge.m_points.push_back({
+				s * s * s * p0.m_x + 3 * s * s * t * p1.m_x + 3 * s * t * t * p2.m_x + t * t * t * p3.m_x,
+				s * s * s * p0.m_y + 3 * s * s * t * p1.m_y + 3 * s * t * t * p2.m_y + t * t * t * p3.m_y
+			});
+		}
+
+		ctx.addEdge(std::move(edge));
+		return 0;
+	};
+
+	funcs.shift = 0;
+	funcs.delta = 0;
+
+	if (FT_Outline_Decompose(&outline, &funcs, &ctx) != FT_Err_Ok)
+		throw std::runtime_error("failed to decompose outline");
+
+	shape.m_contours.erase(std::remove_if(shape.m_contours.begin(), shape.m_contours.end(), [](auto& contour) {
+		return contour.m_edges.empty();
+	}), shape.m_contours.end());
+
+	shape.m_inverted = FT_Outline_Get_Orientation(&outline) == FT_ORIENTATION_POSTSCRIPT;
+
+	colorEdges(shape);
+	return shape;
+}
+
+// Minimal number of glyphs loaded by a task, every task has to create its own face
+static const unsigned int minGlyphsPerTask = 64;
+
+// Creates a library and a face which are only used by the calling thread
+static void withFace(const std::vector<FT_Byte>& data, const std::string& file, unsigned int size, const std::function<void(FT_Face)>& func) {
+	FT_Library lib;
+
+	if (FT_Init_FreeType(&lib) != FT_Err_Ok)
+		throw std::runtime_error("failed to initalize FreeType");
+
+	auto libFin = finalize(lib, FT_Done_FreeType);
+
 	FT_Face face;
-	
-	if (FT_New_Face(m_lib, file.c_str(), 0, &face) != FT_Err_Ok)
+
+	if (FT_New_Memory_Face(lib, data.data(), (FT_Long) data.size(), 0, &face) != FT_Err_Ok)
 		throw std::runtime_error(combine("failed to read font (\"", file, "\")"));
 
 	auto faceFin = finalize(face, FT_Done_Face);
@@ -37,25 +163,330 @@ Font FreeType::load(const std::string& file, unsigned int size, unsigned int col
 	if (FT_Set_Pixel_Sizes(face, 0, size) != FT_Err_Ok)
 		throw std::runtime_error(combine("failed to set size of font (\"", file, "\")"));
 
+	func(face);
+}
+
+// Calls func for every glyph on the pool. FreeType objects can't be shared between threads,
+// so the glyphs are split into chunks and every chunk creates its own library and face.
+static void forEachGlyph(const std::vector<FT_Byte>& data, const std::string& file, unsigned int size, unsigned int count, ThreadPool& pool, const std::function<void(FT_Face, unsigned int)>& func) {
+	auto numChunks = std::max(std::min(count / minGlyphsPerTask, pool.size() * 4), 1u);
+	auto chunkSize = (count + numChunks - 1) / numChunks;
+
+	pool.parallelFor(numChunks, [&](unsigned int chunk) {
+		withFace(data, file, size, [&](FT_Face face) {
+			for (auto i = chunk * chunkSize; i < std::min((chunk + 1) * chunkSize, count); ++i)
+				func(face, i);
+		});
+	});
+}
+
+// Adds the characters of the (sorted and merged) ranges which exist in the font. Characters which are mapped
+// to the same glyph share it, the glyphs are only created with their index.
+static void mapChars(const std::vector<FT_Byte>& data, const std::string& file, unsigned int size, const std::vector<Range>& ranges, Font& f) {
+	withFace(data, file, size, [&](FT_Face face) {
+		std::unordered_map<FT_UInt, unsigned int> glyphs;
+		FT_UInt ind;
+
+		for (auto code = FT_Get_First_Char(face, &ind); ind != 0; code = FT_Get_Next_Char(face, code, &ind)) {
+			auto range = std::upper_bound(ranges.begin(), ranges.end(), code, [](FT_ULong code, const Range& range) { return code < range.m_beg; });
+
+			if (range == ranges.begin() || !(range - 1)->isInside((unsigned int) code))
+				continue;
+
+			auto glyph = glyphs.emplace(ind, (unsigned int) f.m_glyphs.size());
+
+			if (glyph.second)
+				f.m_glyphs.push_back({ ind, 0, 0, 0.0f, 0.0f, GrayImage(0, 0), Image(0, 0) });
+
+			f.m_chars.push_back({ (unsigned int) code, glyph.first->second });
+		}
+	});
+}
+
+// Reads the glyphs of the font from the cache (if there is one), load is called with the glyphs which aren't cached.
+// They are added to the cache afterwards.
+static void loadCached(GlyphCache* cache, GlyphKey key, Font& f, const std::function<void(const std::vector<unsigned int>&)>& load) {
+	std::vector<unsigned int> missing;
+
+	for (unsigned int i = 0; i < f.m_glyphs.size(); ++i) {
+		key.m_glyph = f.m_glyphs[i].m_ind;
+
+		if (!cache || !cache->find(key, f.m_glyphs[i]))
+			missing.push_back(i);
+	}
+
+	load(missing);
+
+	if (cache) {
+		for (auto i : missing) {
+			key.m_glyph = f.m_glyphs[i].m_ind;
+			cache->add(key, f.m_glyphs[i]);
+		}
+	}
+}
+
+std::shared_ptr<const FreeType::FontFile> FreeType::readFont(const std::string& file) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto& font = m_files[file];
+
+	if (!font) {
+		std::ifstream f(file, std::ios::binary);
+
+		if (!f)
+			throw std::runtime_error(combine("failed to read font (\"", file, "\")"));
+
+		std::unique_ptr<FontFile> data(new FontFile());
+		data->m_data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		data->m_hash = m_cache ? GlyphCache::hash(data->m_data.data(), data->m_data.size()) : 0;
+
+		font = std::move(data);
+	}
+
+	return font;
+}
+
+Font FreeType::load(const std::string& file, unsigned int size, const std::vector<Range>& ranges) {
+	return render(file, size, 0, 1, ranges);
+}
+
+Font FreeType::loadDistantField(const std::string& file, unsigned int size, unsigned int spread, unsigned int downscale, const std::vector<Range>& ranges) {
+	return render(file, size, spread, downscale, ranges);
+}
+
+Font FreeType::render(const std::string& file, unsigned int size, unsigned int spread, unsigned int downscale, const std::vector<Range>& ranges) {
+	auto font = readFont(file);
+	auto& data = font->m_data;
+	auto renderSize = size * downscale;
+
+	// Every glyph is written to its own slot, so the order doesn't depend on the tasks
 	Font f;
+	mapChars(data, file, renderSize, ranges, f);
+
+	GlyphKey key = {
+		font->m_hash, renderSize, spread != 0 ? GlyphType::DistantField : GlyphType::Coverage,
+		spread, spread != 0 ? downscale : 0, 0, 0
+	};
 
-	for (auto& range : ranges) {
-		for (auto i = range.m_beg; i <= range.m_end; ++i) {
-			if (FT_Load_Char(face, i, FT_LOAD_RENDER) != FT_Err_Ok)
+	loadCached(m_cache, key, f, [&](const std::vector<unsigned int>& glyphs) {
+		forEachGlyph(data, file, renderSize, glyphs.size(), m_pool, [&](FT_Face face, unsigned int k) {
+			auto& glyph = f.m_glyphs[glyphs[k]];
+
+			if (FT_Load_Glyph(face, glyph.m_ind, FT_LOAD_RENDER) != FT_Err_Ok)
 				throw std::runtime_error(combine("failed to load character (\"", file, "\")"));
 
 			auto slot = face->glyph;
 
-			f.m_glyphs.push_back({
-				i, slot->bitmap_left,
-				(int) size - slot->bitmap_top,
+			glyph = {
+				glyph.m_ind, slot->bitmap_left,
+				(int) renderSize - slot->bitmap_top,
 				slot->advance.x / 64.0f,
 				slot->advance.y / 64.0f,
-				imageFromSlot(slot, color)
+				imageFromSlot(slot),
+				Image(0, 0)
+			};
+		});
+
+		// Every glyph is a separate task, large glyphs are split again
+		if (spread != 0) {
+			m_pool.parallelFor(glyphs.size(), [&](unsigned int k) {
+				auto& glyph = f.m_glyphs[glyphs[k]];
+				glyph.m_img = distantFieldFromImage(glyph.m_img, spread, downscale, &m_pool);
 			});
 		}
-	}
+	});
 
 	return f;
 }
+
+Font FreeType::loadMultiDistantField(const std::string& file, unsigned int size, unsigned int range, const std::vector<Range>& ranges) {
+	auto font = readFont(file);
+	auto& data = font->m_data;
+
+	Font f;
+	mapChars(data, file, size, ranges, f);
+
+	GlyphKey key = { font->m_hash, size, GlyphType::MultiDistantField, range, 0, 0, 0 };
+
+	loadCached(m_cache, key, f, [&](const std::vector<unsigned int>& glyphs) {
+		std::vector<Shape> shapes(f.m_glyphs.size());
+
+		forEachGlyph(data, file, size, glyphs.size(), m_pool, [&](FT_Face face, unsigned int k) {
+			auto i = glyphs[k];
+			auto& glyph = f.m_glyphs[i];
+
+			if (FT_Load_Glyph(face, glyph.m_ind, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING) != FT_Err_Ok)
+				throw std::runtime_error(combine("failed to load character (\"", file, "\")"));
+
+			auto slot = face->glyph;
+
+			if (slot->format != FT_GLYPH_FORMAT_OUTLINE)
+				throw std::runtime_error(combine("font doesn't contain outlines (\"", file, "\")"));
+
+			shapes[i] = shapeFromOutline(slot->outline);
+
+			FT_BBox box;
+			FT_Outline_Get_CBox(&slot->outline, &box);
+
+			glyph = {
+				glyph.m_ind, (int) std::floor(box.xMin / 64.0),
+				(int) size - (int) std::ceil(box.yMax / 64.0),
+				slot->advance.x / 64.0f,
+				slot->advance.y / 64.0f,
+				GrayImage(0, 0),
+				Image(0, 0)
+			};
+		});
+
+		// Distances are computed in parallel, the glyph cell is padded by the range
+		m_pool.parallelFor(glyphs.size(), [&](unsigned int k) {
+			auto i = glyphs[k];
+			auto& glyph = f.m_glyphs[i];
+
+			if (shapes[i].m_contours.empty())
+				return;
+
+			double xMax = -1e240, yMin = 1e240;
+
+			for (auto& contour : shapes[i].m_contours) {
+				for (auto& edge : contour.m_edges) {
+					for (auto& point : edge.m_points) {
+						xMax = std::max(xMax, point.m_x);
+						yMin = std::min(yMin, point.m_y);
+					}
+				}
+			}
+
+			auto top = (int) size - glyph.transY;
+			auto width = (unsigned int) std::max((int) std::ceil(xMax) - glyph.transX, 0) + 2 * range;
+			auto height = (unsigned int) std::max(top - (int) std::floor(yMin), 0) + 2 * range;
+
+			glyph.m_colorImg = multiDistantFieldFromShape(shapes[i], glyph.transX - (double) range, top + (double) range, width, height, range);
+		});
+	});
+
+	return f;
+}
+
+// Reads the glyph pairs of the horizontal subtables of the kern table, which are the only pairs FreeType kerns
+// in TrueType and OpenType fonts. The subtables are checked like FreeType does. Returns false without a kern table.
+static bool readKerningPairs(FT_Face face, std::vector<std::pair<unsigned int, unsigned int>>& pairs) {
+	FT_ULong length = 0;
+
+	if (!FT_IS_SFNT(face) || FT_Load_Sfnt_Table(face, TTAG_kern, 0, nullptr, &length) != FT_Err_Ok)
+		return false;
+
+	std::vector<FT_Byte> table(length);
+
+	if (FT_Load_Sfnt_Table(face, TTAG_kern, 0, table.data(), &length) != FT_Err_Ok)
+		return false;
+
+	auto read = [&table](FT_ULong offset) {
+		return (unsigned int) table[offset] << 8 | table[offset + 1];
+	};
+
+	if (length < 4)
+		return true;
+
+	auto numTables = read(2);
+	FT_ULong offset = 4;
+
+	for (unsigned int i = 0; i < numTables && offset + 6 <= length; ++i) {
+		auto subtableLength = read(offset + 2), coverage = read(offset + 4);
+
+		if (subtableLength <= 6 + 8)
+			break;
+
+		// Broken lengths and counts are clamped to the table
+		auto end = std::min(offset + subtableLength, length);
+
+		if ((coverage & 3) == 1 && offset + 6 + 8 <= end) {
+			auto first = offset + 6 + 8;
+			auto numPairs = std::min<FT_ULong>(read(offset + 6), (end - first) / 6);
+
+			for (FT_ULong j = 0; j < numPairs; ++j)
+				pairs.push_back({ read(first + j * 6), read(first + j * 6 + 2) });
+		}
+
+		offset = end;
+	}
+
+	return true;
+}
+
+void FreeType::loadKerning(const std::string& file, unsigned int size, bool hinted, Font& f) {
+	auto font = readFont(file);
+	auto& data = font->m_data;
+
+	// Only the pairs of the kern table are looked up. Fonts which are kerned without one (e.g. Type 1 fonts)
+	// look up every pair.
+	bool hasKerning = false, allPairs = false;
+	std::vector<std::vector<unsigned int>> candidates(f.m_glyphs.size());
+
+	withFace(data, file, size, [&](FT_Face face) {
+		hasKerning = FT_HAS_KERNING(face) != 0;
+
+		std::vector<std::pair<unsigned int, unsigned int>> tablePairs;
+
+		if (!hasKerning || !readKerningPairs(face, tablePairs)) {
+			allPairs = true;
+			return;
+		}
+
+		std::unordered_map<FT_UInt, unsigned int> glyphs;
+
+		for (unsigned int i = 0; i < f.m_glyphs.size(); ++i)
+			glyphs.emplace(f.m_glyphs[i].m_ind, i);
+
+		for (auto& pair : tablePairs) {
+			auto first = glyphs.find(pair.first), second = glyphs.find(pair.second);
+
+			if (first != glyphs.end() && second != glyphs.end())
+				candidates[first->second].push_back(second->second);
+		}
+	});
+
+	if (!hasKerning)
+		return;
+
+	// Pairs are looked up for every first glyph on the pool
+	std::vector<std::vector<std::pair<unsigned int, float>>> pairs(f.m_glyphs.size());
+
+	forEachGlyph(data, file, size, f.m_glyphs.size(), m_pool, [&](FT_Face face, unsigned int i) {
+		// Pairs can be in multiple subtables
+		auto& seconds = candidates[i];
+		std::sort(seconds.begin(), seconds.end());
+		seconds.erase(std::unique(seconds.begin(), seconds.end()), seconds.end());
+
+		auto count = allPairs ? (unsigned int) f.m_glyphs.size() : (unsigned int) seconds.size();
+
+		for (unsigned int k = 0; k < count; ++k) {
+			auto j = allPairs ? k : seconds[k];
+			FT_Vector kerning;
+
+			if (FT_Get_Kerning(face, f.m_glyphs[i].m_ind, f.m_glyphs[j].m_ind, hinted ? FT_KERNING_DEFAULT : FT_KERNING_UNFITTED, &kerning) != FT_Err_Ok)
+				throw std::runtime_error(combine("failed to get kerning (\"", file, "\")"));
+
+			if (kerning.x != 0)
+				pairs[i].push_back({ j, kerning.x / 64.0f });
+		}
+	});
+
+	// Glyphs are shared by characters, so the pairs are expanded to all of their characters
+	std::vector<std::vector<unsigned int>> chars(f.m_glyphs.size());
+
+	for (auto& chr : f.m_chars)
+		chars[chr.second].push_back(chr.first);
+
+	f.m_kerning.clear();
+
+	for (auto& first : f.m_chars)
+		for (auto& pair : pairs[first.second])
+			for (auto second : chars[pair.first])
+				f.m_kerning.push_back({ first.first, second, pair.second });
+
+	std::sort(f.m_kerning.begin(), f.m_kerning.end(), [](const Kerning& a, const Kerning& b) {
+		return a.m_first < b.m_first || (a.m_first == b.m_first && a.m_second < b.m_second);
+	});
+}
 #endif
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 #include <ft2build.h>
 #include <freetype/freetype.h>
@@ -9,25 +13,83 @@
 #include "Range.hpp"
 
 struct Glyph {
+	// Index of the glyph in the font
 	unsigned int m_ind;
 	int transX;
 	int transY;
 	float advX;
 	float advY;
-	Image m_img;
+
+	// Coverage or signed distant field
+	GrayImage m_img;
+
+	// Multi channel signed distant field
+	Image m_colorImg;
+
+	inline unsigned int width() const {
+		return m_colorImg.empty() ? m_img.width() : m_colorImg.width();
+	}
+
+	inline unsigned int height() const {
+		return m_colorImg.empty() ? m_img.height() : m_colorImg.height();
+	}
+
+	inline bool empty() const {
+		return m_img.empty() && m_colorImg.empty();
+	}
+};
+
+class ThreadPool;
+
+struct Kerning {
+	unsigned int m_first;
+	unsigned int m_second;
+	float m_x;
 };
 
 struct Font {
 	std::vector<Glyph> m_glyphs;
+
+	// Characters and the index of their glyph, sorted by character
+	std::vector<std::pair<unsigned int, unsigned int>> m_chars;
+
+	// Kerning of character pairs, sorted by the first and second character
+	std::vector<Kerning> m_kerning;
 };
 
+class GlyphCache;
+
+// Glyphs are loaded on the pool, every task uses its own FreeType library and face.
+// If there is a cache, only glyphs which aren't cached are loaded.
 class FreeType {
 public:
-	FreeType();
-	~FreeType();
+	FreeType(ThreadPool& pool, GlyphCache* cache = nullptr): m_pool(pool), m_cache(cache) { }
+
+	Font load(const std::string& file, unsigned int size, const std::vector<Range>& ranges);
+
+	// Renders the glyphs downscale times larger and converts them to signed distant fields
+	Font loadDistantField(const std::string& file, unsigned int size, unsigned int spread, unsigned int downscale, const std::vector<Range>& ranges);
+
+	// Generates multi channel signed distant fields from the outlines, range is the spread in pixels
+	Font loadMultiDistantField(const std::string& file, unsigned int size, unsigned int range, const std::vector<Range>& ranges);
 
-	Font load(const std::string& file, unsigned int size, unsigned int color, const std::vector<Range>& ranges);
+	// Adds the kerning between all loaded characters (of the kerning table), hinted kerning is used if hinted is set
+	void loadKerning(const std::string& file, unsigned int size, bool hinted, Font& f);
 
 private:
-	FT_Library m_lib = nullptr;
+	struct FontFile {
+		std::vector<FT_Byte> m_data;
+		unsigned long long m_hash;
+	};
+
+	// Font files are only read once, all sizes of a font share the file
+	std::shared_ptr<const FontFile> readFont(const std::string& file);
+
+	Font render(const std::string& file, unsigned int size, unsigned int spread, unsigned int downscale, const std::vector<Range>& ranges);
+
+	ThreadPool& m_pool;
+	GlyphCache* m_cache;
+
+	std::mutex m_mutex;
+	std::map<std::string, std::shared_ptr<const FontFile>> m_files;
 };
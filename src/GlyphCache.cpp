@@ -0,0 +1,201 @@
+#ifndef DISABLE_FREETYPE
+// Disable warnings for fopen
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "GlyphCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+#include "Utils.hpp"
+
+static_assert(sizeof(GlyphKey) == 32, "unexpected size of glyph key");
+
+GlyphCache::GlyphCache(const std::string& file): m_file(file) {
+	open();
+}
+
+void GlyphCache::open() {
+	static_assert(sizeof(Header) == 16 && sizeof(Entry) == 72, "unexpected size of cache entries");
+
+	m_entries = nullptr;
+	m_numEntries = 0;
+	m_map.reset(new MappedFile(m_file));
+
+	auto data = m_map->data();
+	auto size = m_map->size();
+
+	if (size < sizeof(Header))
+		return;
+
+	auto header = (const Header*) data;
+
+	if (memcmp(header->m_magic, "MKGC", 4) != 0 || header->m_version != Version)
+		return;
+
+	if ((size - sizeof(Header)) / sizeof(Entry) < header->m_numEntries)
+		return;
+
+	auto entries = (const Entry*) (data + sizeof(Header));
+
+	// Glyphs which point outside of the file invalidate the whole cache
+	for (unsigned int i = 0; i < header->m_numEntries; ++i) {
+		auto& entry = entries[i];
+		auto bytes = (unsigned long long) entry.m_width * entry.m_height * entry.m_channels;
+
+		if ((entry.m_channels != 1 && entry.m_channels != 4) || entry.m_offset > size || bytes > size - entry.m_offset)
+			return;
+	}
+
+	m_entries = entries;
+	m_numEntries = header->m_numEntries;
+}
+
+unsigned long long GlyphCache::hash(const unsigned char* data, std::size_t size) {
+	// FNV-1a
+	unsigned long long hash = 14695981039346656037ull;
+
+	for (std::size_t i = 0; i < size; ++i)
+		hash = (hash ^ data[i]) * 1099511628211ull;
+
+	return hash;
+}
+
+bool GlyphCache::isLess(const GlyphKey& a, const GlyphKey& b) {
+	return std::tie(a.m_font, a.m_size, a.m_type, a.m_spread, a.m_downscale, a.m_glyph) <
+		std::tie(b.m_font, b.m_size, b.m_type, b.m_spread, b.m_downscale, b.m_glyph);
+}
+
+bool GlyphCache::find(const GlyphKey& key, Glyph& glyph) const {
+	auto it = std::lower_bound(m_entries, m_entries + m_numEntries, key, [](const Entry& entry, const GlyphKey& key) {
+		return isLess(entry.m_key, key);
+	});
+
+	if (it == m_entries + m_numEntries || isLess(key, it->m_key))
+		return false;
+
+	glyph.m_ind = key.m_glyph;
+	glyph.transX = it->m_transX;
+	glyph.transY = it->m_transY;
+	glyph.advX = it->m_advX;
+	glyph.advY = it->m_advY;
+	glyph.m_img = GrayImage(0, 0);
+	glyph.m_colorImg = Image(0, 0);
+
+	auto pixels = m_map->data() + it->m_offset;
+
+	if (it->m_channels == 4) {
+		glyph.m_colorImg = Image(it->m_width, it->m_height);
+		memcpy(glyph.m_colorImg.data(), pixels, it->m_width * it->m_height * sizeof(unsigned int));
+	}
+	else {
+		glyph.m_img = GrayImage(it->m_width, it->m_height);
+		memcpy(glyph.m_img.data(), pixels, it->m_width * it->m_height);
+	}
+
+	return true;
+}
+
+void GlyphCache::add(const GlyphKey& key, const Glyph& glyph) {
+	Entry entry;
+	memset(&entry, 0, sizeof(entry));
+
+	entry.m_key = key;
+	entry.m_key.m_reserved = 0;
+	entry.m_transX = glyph.transX;
+	entry.m_transY = glyph.transY;
+	entry.m_advX = glyph.advX;
+	entry.m_advY = glyph.advY;
+	entry.m_width = glyph.width();
+	entry.m_height = glyph.height();
+	entry.m_channels = glyph.m_colorImg.empty() ? 1 : 4;
+
+	std::vector<unsigned char> pixels;
+
+	if (glyph.m_colorImg.empty())
+		pixels.assign(glyph.m_img.data(), glyph.m_img.data() + glyph.m_img.width() * glyph.m_img.height());
+	else
+		pixels.assign((const unsigned char*) glyph.m_colorImg.data(), (const unsigned char*) (glyph.m_colorImg.data() + glyph.m_colorImg.width() * glyph.m_colorImg.height()));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_added.push_back(entry);
+	m_addedPixels.push_back(std::move(pixels));
+}
+
+void GlyphCache::save() {
+	if (m_added.empty())
+		return;
+
+	// Glyphs of the file and added glyphs are merged, the pixels are referenced by their source
+	struct Source {
+		Entry m_entry;
+		const unsigned char* m_pixels;
+	};
+
+	std::vector<Source> sources;
+	sources.reserve(m_numEntries + m_added.size());
+
+	for (unsigned int i = 0; i < m_numEntries; ++i)
+		sources.push_back({ m_entries[i], m_map->data() + m_entries[i].m_offset });
+
+	for (unsigned int i = 0; i < m_added.size(); ++i)
+		sources.push_back({ m_added[i], m_addedPixels[i].data() });
+
+	std::stable_sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) {
+		return isLess(a.m_entry.m_key, b.m_entry.m_key);
+	});
+
+	// The same glyph can be added twice if a font is used multiple times
+	sources.erase(std::unique(sources.begin(), sources.end(), [](const Source& a, const Source& b) {
+		return !isLess(a.m_entry.m_key, b.m_entry.m_key) && !isLess(b.m_entry.m_key, a.m_entry.m_key);
+	}), sources.end());
+
+	// The file stays mapped while it's written, so a new file replaces it afterwards
+	auto tempFile = m_file + ".tmp";
+
+	{
+		auto f = finalize(fopen(tempFile.c_str(), "wb"), fclose);
+
+		if (!f)
+			throw std::runtime_error(combine("failed to open file (\"", tempFile, "\")"));
+
+		Header header = { { 'M', 'K', 'G', 'C' }, Version, (unsigned int) sources.size(), 0 };
+		fwrite(&header, sizeof(header), 1, f.get());
+
+		auto offset = (unsigned long long) sizeof(Header) + sources.size() * sizeof(Entry);
+
+		for (auto& source : sources) {
+			auto entry = source.m_entry;
+			entry.m_offset = offset;
+			offset += (unsigned long long) entry.m_width * entry.m_height * entry.m_channels;
+
+			fwrite(&entry, sizeof(entry), 1, f.get());
+		}
+
+		for (auto& source : sources)
+			fwrite(source.m_pixels, 1, source.m_entry.m_width * source.m_entry.m_height * source.m_entry.m_channels, f.get());
+
+		if (ferror(f.get()))
+			throw std::runtime_error(combine("failed to write file (\"", tempFile, "\")"));
+	}
+
+	m_entries = nullptr;
+	m_numEntries = 0;
+	m_map.reset();
+
+	std::remove(m_file.c_str());
+
+	if (std::rename(tempFile.c_str(), m_file.c_str()) != 0)
+		throw std::runtime_error(combine("failed to write file (\"", m_file, "\")"));
+
+	m_added.clear();
+	m_addedPixels.clear();
+
+	open();
+}
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Font.hpp"
+#include "Platform.hpp"
+
+enum class GlyphType : unsigned int {
+	Coverage,
+	DistantField,
+	MultiDistantField
+};
+
+// Identifies a rendered glyph, the parameters which don't apply to the type are zero
+struct GlyphKey {
+	unsigned long long m_font;
+	unsigned int m_size;
+	GlyphType m_type;
+	unsigned int m_spread;
+	unsigned int m_downscale;
+	unsigned int m_glyph;
+	unsigned int m_reserved;
+};
+
+// Cache of rendered glyphs which is kept in a file. The file is mapped, so only glyphs which are used are read.
+//
+// Layout of the file (native byte order):
+//   char magic[4] = "MKGC", uint32 version, uint32 numEntries, uint32 reserved
+//   Entry entries[numEntries] (sorted by key)
+//   pixels of the glyphs (single channel or RGBA)
+class GlyphCache {
+public:
+	// The cache is empty if the file doesn't exist or is invalid
+	GlyphCache(const std::string& file);
+
+	// Key of a font file
+	static unsigned long long hash(const unsigned char* data, std::size_t size);
+
+	// Can be called from multiple threads
+	bool find(const GlyphKey& key, Glyph& glyph) const;
+	void add(const GlyphKey& key, const Glyph& glyph);
+
+	// Writes all glyphs (cached and added) to the file, nothing is written if no glyph was added
+	void save();
+
+private:
+	static const unsigned int Version = 1;
+
+	struct Header {
+		char m_magic[4];
+		unsigned int m_version;
+		unsigned int m_numEntries;
+		unsigned int m_reserved;
+	};
+
+	struct Entry {
+		GlyphKey m_key;
+		int m_transX;
+		int m_transY;
+		float m_advX;
+		float m_advY;
+		unsigned int m_width;
+		unsigned int m_height;
+		unsigned int m_channels;
+		unsigned int m_reserved;
+		unsigned long long m_offset;
+	};
+
+	static bool isLess(const GlyphKey& a, const GlyphKey& b);
+
+	void open();
+
+	std::string m_file;
+	std::unique_ptr<MappedFile> m_map;
+	const Entry* m_entries = nullptr;
+	unsigned int m_numEntries = 0;
+
+	std::mutex m_mutex;
+	std::vector<Entry> m_added;
+	std::vector<std::vector<unsigned char>> m_addedPixels;
+};
@@ -15,7 +15,7 @@
 // Stores the message from callback function
 thread_local static const char* message = nullptr;
 
-Image Image::load(const std::string& file) {
+template<> Image Image::load(const std::string& file) {
 	auto f = finalize(fopen(file.c_str(), "rb"), fclose);
 
 	if (!f)
@@ -83,7 +83,7 @@ Image Image::load(const std::string& file) {
 	png_read_update_info(png.get(), info.get());
 
 	auto rowBytes = png_get_rowbytes(png.get(), info.get());
-	img.m_data.resize(rowBytes * img.m_height);
+	img.m_data.resize(rowBytes / sizeof(unsigned int) * img.m_height);
 
 	std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[img.m_height]);
 
@@ -95,7 +95,11 @@ Image Image::load(const std::string& file) {
 	return img;
 }
 
-void Image::save(const std::string& file) const {
+template<typename Pixel> void BasicImage<Pixel>::save(const std::string& file) const {
+	save(file, m_width, m_height, [this](unsigned int y) { return &at(0, y); });
+}
+
+template<typename Pixel> void BasicImage<Pixel>::save(const std::string& file, unsigned int width, unsigned int height, const std::function<const Pixel*(unsigned int)>& getRow) {
 	auto f = finalize(fopen(file.c_str(), "wb"), fclose);
 
 	if (!f)
@@ -125,26 +129,32 @@ void Image::save(const std::string& file) const {
 		throw std::bad_alloc();
 
 	png_set_IHDR(
-		png.get(), info.get(), m_width, m_height, 8,
-		PNG_COLOR_TYPE_RGBA,
+		png.get(), info.get(), width, height, 8,
+		sizeof(Pixel) == 1 ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGBA,
 		PNG_INTERLACE_NONE,
 		PNG_COMPRESSION_TYPE_DEFAULT,
 		PNG_FILTER_TYPE_DEFAULT
 	);
 
-	auto rowBytes = 4 * m_width;
+	png_init_io(png.get(), f.get());
+	png_write_info(png.get(), info.get());
+
+	for (unsigned int i = 0; i < height; i++)
+		png_write_row(png.get(), (png_const_bytep) getRow(i));
 
-	std::unique_ptr<png_bytep[]> rowPointers(new png_bytep[m_height]);
+	png_write_end(png.get(), nullptr);
+}
 
-	for (unsigned int i = 0; i < m_height; i++)
-		rowPointers[i] = (png_bytep) m_data.data() + i * rowBytes;
+// RGBA pixels are covered if their alpha isn't zero, single channel pixels if their value isn't zero
+static inline bool isCovered(unsigned int color) {
+	return (color & 0xFF000000) != 0;
+}
 
-	png_init_io(png.get(), f.get());
-	png_set_rows(png.get(), info.get(), rowPointers.get());
-	png_write_png(png.get(), info.get(), PNG_TRANSFORM_IDENTITY, nullptr);
+static inline bool isCovered(unsigned char value) {
+	return value != 0;
 }
 
-Rectangle Image::getBounds() const {
+template<typename Pixel> Rectangle BasicImage<Pixel>::getBounds() const {
 	unsigned int x1 = 0, y1 = 0, x2 = m_width - 1, y2 = m_height - 1;
 
 	// Search for upper border
@@ -152,7 +162,7 @@ Rectangle Image::getBounds() const {
 		unsigned int i;
 
 		for (i = 0; i < m_width; ++i)
-			if (at(i, y1) & 0xFF000000)
+			if (isCovered(at(i, y1)))
 				break;
 
 		if (i < m_width)
@@ -168,7 +178,7 @@ Rectangle Image::getBounds() const {
 		unsigned int i;
 
 		for (i = 0; i < m_width; ++i)
-			if (at(i, y2) & 0xFF000000)
+			if (isCovered(at(i, y2)))
 				break;
 
 		if (i < m_width)
@@ -180,7 +190,7 @@ Rectangle Image::getBounds() const {
 		unsigned int i;
 
 		for (i = y1; i <= y2; ++i)
-			if (at(x1, i) & 0xFF000000)
+			if (isCovered(at(x1, i)))
 				break;
 
 		if (i <= y2)
@@ -192,7 +202,7 @@ Rectangle Image::getBounds() const {
 		unsigned int i;
 
 		for (i = y1; i <= y2; ++i)
-			if (at(x2, i) & 0xFF000000)
+			if (isCovered(at(x2, i)))
 				break;
 
 		if (i <= y2)
@@ -202,7 +212,7 @@ Rectangle Image::getBounds() const {
 	return { x1, y1, x2 - x1 + 1, y2 - y1 + 1 };
 }
 
-void Image::copy(const Image& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy) {
+template<typename Pixel> void BasicImage<Pixel>::copy(const BasicImage& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy) {
 	assert(x + w <= img.width());
 	assert(y + h <= img.height());
 	assert(dx + w <= width());
@@ -223,7 +233,7 @@ void Image::copy(const Image& img, unsigned int x, unsigned int y, unsigned int
 	}
 }
 
-void Image::copyFlipped(const Image& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy) {
+template<typename Pixel> void BasicImage<Pixel>::copyFlipped(const BasicImage& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy) {
 	assert(x + w <= img.width());
 	assert(y + h <= img.height());
 
@@ -249,7 +259,7 @@ void Image::copyFlipped(const Image& img, unsigned int x, unsigned int y, unsign
 	}
 }
 
-void Image::fill(unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int color) {
+template<typename Pixel> void BasicImage<Pixel>::fill(unsigned int x, unsigned int y, unsigned int w, unsigned int h, Pixel color) {
 	assert(x + w <= width());
 	assert(y + h <= height());
 
@@ -264,7 +274,7 @@ void Image::fill(unsigned int x, unsigned int y, unsigned int w, unsigned int h,
 	}
 }
 
-void Image::copyLineHor(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
+template<typename Pixel> void BasicImage<Pixel>::copyLineHor(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
 	assert(x + length <= img.width());
 	assert(y < img.height());
 	assert(dx + length <= width());
@@ -277,7 +287,7 @@ void Image::copyLineHor(const Image& img, unsigned int x, unsigned int y, unsign
 		*pointerDst++ = *pointerSrc++;
 }
 
-void Image::copyLineVert(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
+template<typename Pixel> void BasicImage<Pixel>::copyLineVert(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
 	assert(x < img.width());
 	assert(y + length <= img.height());
 	assert(dx < width());
@@ -297,7 +307,7 @@ void Image::copyLineVert(const Image& img, unsigned int x, unsigned int y, unsig
 	}
 }
 
-void Image::copyLineHorFlipped(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
+template<typename Pixel> void BasicImage<Pixel>::copyLineHorFlipped(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
 	assert(x + length <= img.height());
 	assert(y < img.width());
 	assert(dx + length <= width());
@@ -314,7 +324,7 @@ void Image::copyLineHorFlipped(const Image& img, unsigned int x, unsigned int y,
 	}
 }
 
-void Image::copyLineVertFlipped(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
+template<typename Pixel> void BasicImage<Pixel>::copyLineVertFlipped(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy) {
 	assert(x < img.height());
 	assert(y + length <= img.width());
 	assert(dx < width());
@@ -330,3 +340,24 @@ void Image::copyLineVertFlipped(const Image& img, unsigned int x, unsigned int y
 		pointerDst += strideDst;
 	}
 }
+
+Image imageFromAlpha(const GrayImage& img, unsigned int color) {
+	Image res(img.width(), img.height());
+
+	for (unsigned int i = 0; i < img.width() * img.height(); ++i)
+		res.data()[i] = img.data()[i] << 24 | (color & 0xFFFFFF);
+
+	return res;
+}
+
+Image imageFromGray(const GrayImage& img) {
+	Image res(img.width(), img.height());
+
+	for (unsigned int i = 0; i < img.width() * img.height(); ++i)
+		res.data()[i] = makeRBGA(img.data()[i], img.data()[i], img.data()[i], 0xFF);
+
+	return res;
+}
+
+template class BasicImage<unsigned int>;
+template class BasicImage<unsigned char>;
@@ -2,16 +2,21 @@
 
 #include "Rectangle.hpp"
 
+#include <functional>
 #include <string>
 #include <vector>
 
-class Image {
+// Image with pixels of type Pixel. 32 bit pixels are RGBA, 8 bit pixels are a single channel.
+template<typename Pixel> class BasicImage {
 public:
-	Image(unsigned int width, unsigned int height): m_width(width), m_height(height), m_data(width * height) { }
+	BasicImage(unsigned int width, unsigned int height): m_width(width), m_height(height), m_data(width * height) { }
 
-	static Image load(const std::string& file);
+	static BasicImage load(const std::string& file);
 	void save(const std::string& file) const;
 
+	// Saves an image whose rows are provided by a callback
+	static void save(const std::string& file, unsigned int width, unsigned int height, const std::function<const Pixel*(unsigned int)>& getRow);
+
 	inline unsigned int width() const {
 		return m_width;
 	}
@@ -24,42 +29,54 @@ public:
 		return m_data.empty();
 	}
 
-	inline unsigned int* data() {
+	inline Pixel* data() {
 		return m_data.data();
 	}
 
-	inline const unsigned int* data() const {
+	inline const Pixel* data() const {
 		return m_data.data();
 	}
 
-	inline unsigned int& at(unsigned int x, unsigned int y) {
+	inline Pixel& at(unsigned int x, unsigned int y) {
 		return m_data[y * m_width + x];
 	}
 
-	inline const unsigned int& at(unsigned int x, unsigned int y) const {
+	inline const Pixel& at(unsigned int x, unsigned int y) const {
 		return m_data[y * m_width + x];
 	}
 
-	inline unsigned int& atFlipped(unsigned int x, unsigned int y) {
+	inline Pixel& atFlipped(unsigned int x, unsigned int y) {
 		return at(m_width - y - 1, x);
 	}
 
-	inline const unsigned int& atFlipped(unsigned int x, unsigned int y) const {
+	inline const Pixel& atFlipped(unsigned int x, unsigned int y) const {
 		return at(m_width - y - 1, x);
 	}
 
 	Rectangle getBounds() const;
 
-	void copy(const Image& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy);
-	void copyFlipped(const Image& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy);
-	void fill(unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int color);
-	void copyLineHor(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
-	void copyLineVert(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
-	void copyLineHorFlipped(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
-	void copyLineVertFlipped(const Image& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
+	void copy(const BasicImage& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy);
+	void copyFlipped(const BasicImage& img, unsigned int x, unsigned int y, unsigned int w, unsigned int h, unsigned int dx, unsigned int dy);
+	void fill(unsigned int x, unsigned int y, unsigned int w, unsigned int h, Pixel color);
+	void copyLineHor(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
+	void copyLineVert(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
+	void copyLineHorFlipped(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
+	void copyLineVertFlipped(const BasicImage& img, unsigned int x, unsigned int y, unsigned int length, unsigned int dx, unsigned int dy);
 
 private:
 	unsigned int m_width;
 	unsigned int m_height;
-	std::vector<unsigned int> m_data;
+	std::vector<Pixel> m_data;
 };
+
+typedef BasicImage<unsigned int> Image;
+typedef BasicImage<unsigned char> GrayImage;
+
+// Only RGBA images can be loaded
+template<> Image Image::load(const std::string& file);
+
+// Expands a single channel image, the value is used as alpha of color
+Image imageFromAlpha(const GrayImage& img, unsigned int color);
+
+// Expands a single channel image into an opaque gray image
+Image imageFromGray(const GrayImage& img);
@@ -0,0 +1,93 @@
+#include "ImageCache.hpp"
+
+#include <cstring>
+
+#include "Dedup.hpp"
+
+Image ImageCache::crop(const Image& img, const Rectangle& rect) {
+	if (rect.m_x == 0 && rect.m_y == 0 && rect.m_w == img.width() && rect.m_h == img.height())
+		return img;
+
+	Image res(rect.m_w, rect.m_h);
+
+	if (!res.empty())
+		res.copy(img, rect.m_x, rect.m_y, rect.m_w, rect.m_h, 0, 0);
+
+	return res;
+}
+
+unsigned long long ImageCache::hash(const Image& img) {
+	return hashBytes(img.data(), img.width() * img.height() * sizeof(unsigned int), img.width());
+}
+
+Image ImageCache::decode(const Entry& entry) {
+	return crop(Image::load(entry.m_file), entry.m_bounds);
+}
+
+void ImageCache::add(const std::string& file, bool trim) {
+	auto img = Image::load(file);
+	auto bounds = trim ? img.getBounds() : Rectangle { 0, 0, img.width(), img.height() };
+
+	// Only keep pixels which are actually drawn, the hash is computed while they are decoded anyway
+	std::size_t bytes = (std::size_t) bounds.m_w * bounds.m_h * sizeof(unsigned int);
+	auto resident = m_budget == 0 || m_resident + bytes <= m_budget;
+	auto cropped = crop(img, bounds);
+	auto pixelHash = hash(cropped);
+
+	m_entries.push_back({
+		file, img.width(), img.height(), bounds, pixelHash, resident,
+		resident ? std::move(cropped) : Image(0, 0)
+	});
+
+	if (resident)
+		m_resident += bytes;
+}
+
+void ImageCache::add(Image img, bool trim) {
+	auto bounds = trim ? img.getBounds() : Rectangle { 0, 0, img.width(), img.height() };
+
+	auto cropped = crop(img, bounds);
+	auto pixelHash = hash(cropped);
+
+	m_entries.push_back({ std::string(), img.width(), img.height(), bounds, pixelHash, true, std::move(cropped) });
+	m_resident += (std::size_t) bounds.m_w * bounds.m_h * sizeof(unsigned int);
+}
+
+void ImageCache::add(const std::string& file, unsigned int width, unsigned int height, const Rectangle& bounds, unsigned long long hash) {
+	m_entries.push_back({ file, width, height, bounds, hash, false, Image(0, 0) });
+}
+
+const Image& ImageCache::get(unsigned int i) {
+	auto& entry = m_entries[i];
+
+	if (entry.m_resident)
+		return entry.m_img;
+
+	m_scratch = Image(0, 0);
+	m_scratch = decode(entry);
+
+	return m_scratch;
+}
+
+bool ImageCache::isEqual(unsigned int a, unsigned int b) const {
+	auto& entryA = m_entries[a];
+	auto& entryB = m_entries[b];
+
+	if (entryA.m_hash != entryB.m_hash || entryA.m_bounds.m_w != entryB.m_bounds.m_w || entryA.m_bounds.m_h != entryB.m_bounds.m_h)
+		return false;
+
+	// Resident pixels are compared in place
+	Image decodedA(0, 0), decodedB(0, 0);
+
+	if (!entryA.m_resident)
+		decodedA = decode(entryA);
+
+	if (!entryB.m_resident)
+		decodedB = decode(entryB);
+
+	auto& imgA = entryA.m_resident ? entryA.m_img : decodedA;
+	auto& imgB = entryB.m_resident ? entryB.m_img : decodedB;
+
+	return imgA.width() == imgB.width() && imgA.height() == imgB.height() &&
+		memcmp(imgA.data(), imgB.data(), imgA.width() * imgA.height() * sizeof(unsigned int)) == 0;
+}
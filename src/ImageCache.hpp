@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Image.hpp"
+
+// Keeps the sizes and bounds of all images, but only as many (trimmed) pixels as the budget allows.
+// Images which don't fit into the budget are decoded again when they are requested.
+class ImageCache {
+public:
+	// A budget of zero keeps every image in memory
+	ImageCache(std::size_t budget): m_budget(budget), m_scratch(0, 0) { }
+
+	void add(const std::string& file, bool trim);
+
+	// Images which aren't loaded from a file are always kept
+	void add(Image img, bool trim);
+
+	// The size, bounds and hash of the image are already known, it's only decoded when it's requested
+	void add(const std::string& file, unsigned int width, unsigned int height, const Rectangle& bounds, unsigned long long hash);
+
+	inline unsigned int size() const {
+		return m_entries.size();
+	}
+
+	inline unsigned int width(unsigned int i) const {
+		return m_entries[i].m_width;
+	}
+
+	inline unsigned int height(unsigned int i) const {
+		return m_entries[i].m_height;
+	}
+
+	inline bool empty(unsigned int i) const {
+		return m_entries[i].m_width == 0 || m_entries[i].m_height == 0;
+	}
+
+	// Area of the image which is used (whole image if it isn't trimmed)
+	inline const Rectangle& getBounds(unsigned int i) const {
+		return m_entries[i].m_bounds;
+	}
+
+	// Hash of the pixels inside the bounds, computed when the image is added
+	inline unsigned long long getHash(unsigned int i) const {
+		return m_entries[i].m_hash;
+	}
+
+	inline std::size_t getResidentBytes() const {
+		return m_resident;
+	}
+
+	// Returns the pixels inside the bounds. The reference is valid until the next call.
+	const Image& get(unsigned int i);
+
+	// Compares the pixels inside the bounds, images which aren't kept are only decoded if their hashes are equal
+	bool isEqual(unsigned int a, unsigned int b) const;
+
+private:
+	struct Entry {
+		std::string m_file;
+		unsigned int m_width;
+		unsigned int m_height;
+		Rectangle m_bounds;
+		unsigned long long m_hash;
+		bool m_resident;
+		Image m_img;
+	};
+
+	static Image crop(const Image& img, const Rectangle& rect);
+	static unsigned long long hash(const Image& img);
+	static Image decode(const Entry& entry);
+
+	std::vector<Entry> m_entries;
+	std::size_t m_budget;
+	std::size_t m_resident = 0;
+	Image m_scratch;
+};
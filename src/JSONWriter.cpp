@@ -1,119 +1,146 @@
 #include "JSONWriter.hpp"
 
-static void writeString(std::ostream& stream, const std::string& value) {
-	const char* table[] = {
+#include <cstdio>
+#include <iterator>
+
+// Escapes control characters, quotes and backslashes
+void JSONWriter::quote(const std::string& value) {
+	static const char* table[] = {
 		"\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
-		"\\b",     "\\t",     "\\n",     "\\u0011", "\\f",     "\\r",     "\\u0014", "\\u0015",
-		"\\u0016", "\\u0017", "\\u0018", "\\u0019", "\\u0020", "\\u0021", "\\u0022", "\\u0023",
-		"\\u0024", "\\u0025", "\\u0026", "\\u0027", "\\u0028", "\\u0029", "\\u0030", "\\u0031",
+		"\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+		"\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+		"\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f",
 	};
 
-	stream << '"';
+	m_buffer += '"';
 
 	auto last = value.begin();
 
 	for (auto it = value.begin(); it != value.end(); ++it) {
-		if (*it == '"') {
-			stream.write(&*last, it - last);
-			stream << "\\\"";
-			last = std::next(it);
-		}
-		else if (*it == '\\') {
-			stream.write(&*last, it - last);
-			stream << "\\\\";
-			last = std::next(it);
-		}
-		else if (*it < 0x20) {
-			stream.write(&*last, it - last);
-			stream << table[*it];
-			last = std::next(it);
-		}
-	}
+		auto chr = (unsigned char) *it;
+
+		if (chr != '"' && chr != '\\' && chr >= 0x20)
+			continue;
+
+		m_buffer.append(last, it);
+
+		if (chr == '"')
+			m_buffer += "\\\"";
+		else if (chr == '\\')
+			m_buffer += "\\\\";
+		else
+			m_buffer += table[chr];
 
-	if (last != value.end())
-		stream.write(&*last, value.end() - last);
+		last = std::next(it);
+	}
 
-	stream << '"';
+	m_buffer.append(last, value.end());
+	m_buffer += '"';
 }
 
 void JSONWriter::prefix() {
 	if (!m_context.empty()) {
-		if (m_context.top().m_type == Context::TypeKey) {
-			m_context.pop();
+		if (m_context.back().m_type == Context::TypeKey) {
+			m_context.pop_back();
 			return;
 		}
 
-		if (m_context.top().m_needsComma)
-			m_stream << ",\n";
+		if (m_context.back().m_needsComma)
+			m_buffer += m_compact ? "," : ",\n";
 		else
-			m_context.top().m_needsComma = true;
+			m_context.back().m_needsComma = true;
 	}
 
 	indent();
 }
 
 void JSONWriter::indent() {
-	for (unsigned int i = 0; i < m_context.size(); ++i)
-		m_stream << '\t';
+	if (!m_compact)
+		m_buffer.append(m_context.size(), '\t');
 }
 
 void JSONWriter::begin() {
 	prefix();
-	m_stream << "{\n";
-	m_context.push({ Context::TypeObject, false });
+	m_buffer += m_compact ? "{" : "{\n";
+	m_context.push_back({ Context::TypeObject, false });
 }
 
 void JSONWriter::beginArray() {
 	prefix();
-	m_stream << "[\n";
-	m_context.push({ Context::TypeArray, false });
+	m_buffer += m_compact ? "[" : "[\n";
+	m_context.push_back({ Context::TypeArray, false });
 }
 
 void JSONWriter::end() {
-	auto con = m_context.top();
-	m_context.pop();
+	auto con = m_context.back();
+	m_context.pop_back();
+
+	if (!m_compact)
+		m_buffer += '\n';
 
-	m_stream << '\n';
 	indent();
 
 	switch (con.m_type) {
 	case Context::TypeObject:
-		m_stream << "}";
+		m_buffer += '}';
 		break;
 	case Context::TypeArray:
-		m_stream << "]";
+		m_buffer += ']';
 		break;
 	}
 }
 
 void JSONWriter::writeString(const std::string& str) {
 	prefix();
-	::writeString(m_stream, str);
+	quote(str);
 }
 
 void JSONWriter::writeInt(int value) {
 	prefix();
-	m_stream << value;
+
+	if (value < 0) {
+		m_buffer += '-';
+		writeDigits(0u - (unsigned int) value);
+	}
+	else
+		writeDigits((unsigned int) value);
 }
 
 void JSONWriter::writeUint(unsigned int value) {
 	prefix();
-	m_stream << value;
+	writeDigits(value);
 }
 
 void JSONWriter::writeBool(bool value) {
 	prefix();
-	m_stream << (value ? "true" : "false");
+	m_buffer += value ? "true" : "false";
 }
 
 void JSONWriter::writeDouble(double value) {
 	prefix();
-	m_stream << value;
+
+	// Same format as the default of streams
+	char str[32];
+	auto length = snprintf(str, sizeof(str), "%g", value);
+	m_buffer.append(str, length);
+}
+
+void JSONWriter::writeDigits(unsigned int value) {
+	char str[10];
+	auto end = str + sizeof(str);
+	auto beg = end;
+
+	do {
+		*--beg = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	m_buffer.append(beg, end);
 }
 
 void JSONWriter::key(const std::string& str) {
 	prefix();
-	::writeString(m_stream, str);
-	m_stream << ": ";
-	m_context.push({ Context::TypeKey, false });
+	quote(str);
+	m_buffer += m_compact ? ":" : ": ";
+	m_context.push_back({ Context::TypeKey, false });
 }
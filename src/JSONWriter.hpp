@@ -1,11 +1,12 @@
 #pragma once
 
-#include <ostream>
-#include <stack>
+#include <string>
+#include <vector>
 
+// Formats JSON into a buffer, which can be written at once. Compact JSON contains no whitespace.
 class JSONWriter {
 public:
-	JSONWriter(std::ostream& stream): m_stream(stream) { }
+	JSONWriter(bool compact = false): m_compact(compact) { }
 
 	void begin();
 	void beginArray();
@@ -19,6 +20,10 @@ public:
 
 	void key(const std::string& str);
 
+	const std::string& data() const {
+		return m_buffer;
+	}
+
 private:
 	struct Context {
 		enum {
@@ -33,7 +38,10 @@ private:
 
 	void prefix();
 	void indent();
+	void quote(const std::string& str);
+	void writeDigits(unsigned int value);
 
-	std::ostream& m_stream;
-	std::stack<Context> m_context;
+	bool m_compact;
+	std::string m_buffer;
+	std::vector<Context> m_context;
 };
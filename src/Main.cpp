@@ -1,19 +1,17 @@
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <memory>
 
 #include "ArgParser.hpp"
-#include "Image.hpp"
+#include "AtlasBuilder.hpp"
+#include "BuildCache.hpp"
+#include "Dedup.hpp"
+#include "Manifest.hpp"
 #include "Platform.hpp"
-#include "MaxRects.hpp"
-#include "Canvas.hpp"
-#include "JSONWriter.hpp"
-#include "DistantField.hpp"
-
-#ifndef DISABLE_FREETYPE
-	#include "Font.hpp"
-#endif
 
 const char versionString[] =
 	"MKATLAS v1.0\n"
@@ -52,313 +50,335 @@ const char helpString[] =
 	"\t-p --padding <val>  Set padding between images.\n"
 	"\t--width <width>     Set width of textures.\n"
 	"\t--height <height>   Set height of textures.\n"
-	"\t-s --size <size>    Set width and height of textures.\n"
+	"\t-s --size <size>    Set width and height of textures (or auto).\n"
+	"\t--maxsize <size>    Set maximal size of textures used by auto.\n"
+	"\t--shrink            Shrink textures to the used area.\n"
+	"\t--pot               Keep shrunk or automatic sizes a power of two.\n"
+	"\t--align <val>       Round shrunk or automatic sizes up to a multiple of val.\n"
 	"\t--folder <folder>   Set output folder of textures.\n"
+	"\t--gray              Save textures as 8 bit grayscale (only glyphs).\n"
+	"\t--channels          Pack glyphs into every channel of the textures.\n"
+	"\t--memorybudget <mb> Limit memory used to keep decoded images.\n"
+	"\t--threads <val>     Set number of worker threads (0 uses all cores).\n"
 	"\t-o --out <output>   Set output file.\n"
+	"\t--binary            Write metadata in binary format instead of JSON.\n"
+	"\t--compact           Write JSON without whitespace.\n"
+	"\t--header <file>     Also write metadata as C++ header.\n"
+	"\t--incremental       Only rebuild what changed since the last incremental build.\n"
+	"\t--serve             Read command lines from stdin and build them with warm caches.\n"
 #ifndef DISABLE_FREETYPE
+	"\t--cache <file>      Cache rendered glyphs in file.\n"
 	"\t-f --font <file>    Add font.\n"
 	"\t-n --name <name>    Set name of font.\n"
-	"\t-i --size <size>    Set size of font.\n"
+	"\t-i --size <size>    Set size of font (or comma separated sizes).\n"
 	"\t-c --color <color>  Set color of font in hex.\n"
 	"\t--dfsize <size>     Set scaling of input image used to generate signed distant field.\n"
 	"\t--dfspread <spread> Set spread of signed distant field.\n"
+	"\t--msdf              Generate multi channel signed distant field from outlines.\n"
+	"\t--kerning           Add kerning of the characters of font.\n"
+	"\t--kerninghash       Also hash kerning pairs in binary metadata and headers.\n"
 	"\t-r --range <range>  Add characters to font (can be <num> or <beg>-<end>).\n"
 #endif
 	;
 
-int main(int argc, const char** argv) {
-	try {
-	#ifndef DISABLE_FREETYPE
-		FreeType ft;
-	#endif
-
-		auto opt = parseArguments((unsigned int) argc - 1, argv + 1);
-
-		if (opt.m_help) {
-			std::cout << helpString << std::endl;
-			return 0;
-		}
-
-		if (opt.m_version) {
-			std::cout << versionString << std::endl;
-			return 0;
-		}
-
-	#ifdef DISABLE_FREETYPE
-		if (opt.m_files.empty())
-			throw std::runtime_error("no input files selected");
-	#else
-		if (opt.m_files.empty() && opt.m_fonts.empty())
-			throw std::runtime_error("no input files selected");
-	#endif
+static void checkInputs(const Options& opt) {
+#ifdef DISABLE_FREETYPE
+	if (opt.m_files.empty())
+		throw std::runtime_error("no input files selected");
+#else
+	if (opt.m_files.empty() && opt.m_fonts.empty())
+		throw std::runtime_error("no input files selected");
+#endif
+}
 
-		// Parse filenames
-		std::vector<std::string> imageNames;
-		imageNames.reserve(opt.m_files.size());
+static std::string textureFile(unsigned int i) {
+	std::stringstream ss;
+	ss << "texture" << std::setw(2) << std::setfill('0') << i << ".png";
 
-		for (auto& file : opt.m_files)
-			imageNames.push_back(stripExtension(stripBase(file)));
+	return ss.str();
+}
 
-		// Load images
-		std::vector<Image> images;
-		images.reserve(opt.m_files.size());
+// Hash of all options which affect the textures, an incremental build only reuses a build with the same options
+static unsigned long long hashOptions(const Options& opt) {
+	std::vector<unsigned int> values = {
+		opt.m_maxTextures, opt.m_expand, opt.m_trim, opt.m_noFlip, opt.m_shrink, opt.m_powerOfTwo, opt.m_gray, opt.m_channels,
+		opt.m_align, opt.m_padding, opt.m_width, opt.m_height, opt.m_autoSize, opt.m_maxSize
+	};
 
-		for (auto& file : opt.m_files)
-			images.push_back(Image::load(file));
+#ifndef DISABLE_FREETYPE
+	for (auto& font : opt.m_fonts) {
+		values.insert(values.end(), {
+			(unsigned int) font.m_file.size(), font.m_size, font.m_color, font.m_distantFieldSize, font.m_distantFieldSpread,
+			font.m_multiChannel, font.m_kerning, (unsigned int) font.m_ranges.size()
+		});
 
-		std::vector<Rectangle> imageBounds;
+		for (auto& range : font.m_ranges)
+			values.insert(values.end(), { range.m_beg, range.m_end });
 
-		if (opt.m_trim) {
-			imageBounds.reserve(images.size());
+		for (auto chr : font.m_file)
+			values.push_back((unsigned char) chr);
+	}
+#endif
 
-			for (auto& img : images)
-				imageBounds.push_back(img.getBounds());
-		}
+	return hashBytes(values.data(), values.size() * sizeof(unsigned int));
+}
 
-	#ifndef DISABLE_FREETYPE
-		// Load fonts
-		std::vector<Font> fonts;
-		fonts.reserve(opt.m_fonts.size());
+// Builds the atlas of the images and fonts which were added to the builder, writes the textures and the metadata.
+// Textures which didn't change since the previous build aren't written again.
+static Atlas writeAtlas(const Options& opt, AtlasBuilder& builder, const AtlasLayout* previous, unsigned int& numSaved) {
+#ifndef DISABLE_FREETYPE
+	std::unique_ptr<GlyphCache> cache;
 
-		for (auto& font : opt.m_fonts)
-			fonts.push_back(ft.load(font.m_file, font.m_size * font.m_distantFieldSize, font.m_color, font.m_ranges));
-
-		for (unsigned int i = 0; i < fonts.size(); ++i)
-			if (opt.m_fonts[i].m_distantFieldSpread != 0)
-				for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
-					fonts[i].m_glyphs[j].m_img = distantFieldFromImage(
-						fonts[i].m_glyphs[j].m_img, opt.m_fonts[i].m_distantFieldSpread, opt.m_fonts[i].m_distantFieldSize
-					);
-	#endif
+	if (!opt.m_glyphCache.empty())
+		cache.reset(new GlyphCache(opt.m_glyphCache));
 
-		MaxRects mr({
-			opt.m_expand ? opt.m_width : opt.m_width + opt.m_padding,
-			opt.m_expand ? opt.m_height : opt.m_height + opt.m_padding,
-			opt.m_maxTextures, !opt.m_noFlip
-		});
+	builder.setGlyphCache(cache.get());
+#endif
 
-		// Add images to rectangle packer
-		std::vector<RectData> imageRects(images.size());
+	numSaved = 0;
 
-		for (unsigned int i = 0; i < images.size(); ++i)
-			if (opt.m_trim)
-				mr.add(&imageRects[i], imageBounds[i].m_w + opt.m_padding, imageBounds[i].m_h + opt.m_padding);
-			else
-				mr.add(&imageRects[i], images[i].width() + opt.m_padding, images[i].height() + opt.m_padding);
+	auto atlas = builder.build([&numSaved](unsigned int i, const AtlasPage& page) {
+		if (page.isUnchanged())
+			return;
 
-	#ifndef DISABLE_FREETYPE
-		// Add glyphs to rectangle packer
-		std::vector<std::vector<RectData>> fontRects;
-		fontRects.reserve(fonts.size());
+		page.save(textureFile(i));
+		++numSaved;
+	}, previous);
 
-		for (auto& font : fonts) {
-			fontRects.emplace_back(font.m_glyphs.size());
+	for (unsigned int i = 0; i < atlas.m_textures.size(); ++i)
+		atlas.m_textures[i].m_file = textureFile(i);
 
-			for (unsigned int i = 0; i < font.m_glyphs.size(); ++i)
-				mr.add(&fontRects.back()[i], font.m_glyphs[i].m_img.width() + opt.m_padding, font.m_glyphs[i].m_img.height() + opt.m_padding);
-		}
-	#endif
+#ifndef DISABLE_FREETYPE
+	builder.setGlyphCache(nullptr);
 
-		if (!mr.pack())
-			throw std::runtime_error("failed to pack rectangles");
+	if (cache)
+		cache->save();
+#endif
 
-		std::vector<Canvas> canvases(mr.getNumBins(), Canvas(opt.m_width, opt.m_height));
+	if (opt.m_binary)
+		saveBinary(atlas, opt.m_output, opt.m_kerningHash);
+	else
+		saveJSON(atlas, opt.m_output, opt.m_compact);
 
-		for (unsigned int i = 0; i < images.size(); ++i)
-			if (opt.m_trim)
-				canvases[imageRects[i].m_bin].drawRect(images[i], imageBounds[i], imageRects[i].m_x, imageRects[i].m_y, imageRects[i].m_flipped, opt.m_expand ? opt.m_padding : 0);
-			else
-				canvases[imageRects[i].m_bin].draw(images[i], imageRects[i].m_x, imageRects[i].m_y, imageRects[i].m_flipped, opt.m_expand ? opt.m_padding : 0);
+	if (!opt.m_header.empty())
+		saveHeader(atlas, opt.m_header, opt.m_kerningHash);
 
-	#ifndef DISABLE_FREETYPE
-		for (unsigned int i = 0; i < fonts.size(); ++i)
-			for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j)
-				canvases[fontRects[i][j].m_bin].draw(fonts[i].m_glyphs[j].m_img, fontRects[i][j].m_x, fontRects[i][j].m_y, fontRects[i][j].m_flipped, opt.m_expand ? opt.m_padding : 0);
-	#endif
+	return atlas;
+}
 
-		for (unsigned int i = 0; i < canvases.size(); ++i) {
-			std::stringstream ss;
-			ss << "texture" << std::setw(2) << std::setfill('0') << i << ".png";
-			canvases[i].getImage().save(ss.str());
+// Splits a request into arguments, arguments which contain spaces can be quoted
+static std::vector<std::string> splitArguments(const std::string& line) {
+	std::vector<std::string> args;
+	std::string arg;
+	auto quoted = false;
+	auto hasArg = false;
+
+	for (auto chr : line) {
+		if (chr == '"') {
+			quoted = !quoted;
+			hasArg = true;
 		}
+		else if (!quoted && (chr == ' ' || chr == '\t' || chr == '\r')) {
+			if (hasArg)
+				args.push_back(arg);
 
-		// Write to JSON file
-		std::ofstream f(opt.m_output);
-
-		JSONWriter writer(f);
-
-		writer.begin();
-
-		writer.key("textures");
-		writer.beginArray();
-
-		for (unsigned int i = 0; i < mr.getNumBins(); ++i) {
-			writer.begin();
+			arg.clear();
+			hasArg = false;
+		}
+		else {
+			arg += chr;
+			hasArg = true;
+		}
+	}
 
-			writer.key("file");
-			std::stringstream ss;
-			ss << "texture" << std::setw(2) << std::setfill('0') << i << ".png";
-			canvases[i].getImage().save(ss.str());
-			writer.writeString(ss.str());
+	if (hasArg)
+		args.push_back(arg);
 
-			writer.key("width");
-			writer.writeUint(canvases[i].getImage().width());
+	return args;
+}
 
-			writer.key("height");
-			writer.writeUint(canvases[i].getImage().height());
+// Builds the atlas of a request, the images and fonts of the previous requests are reused if their files didn't change
+static std::string handleRequest(const std::vector<std::string>& args, ThreadPool& pool, BuildCache& cache) {
+	auto start = std::chrono::steady_clock::now();
 
-			writer.end();
-		}
+	std::vector<const char*> argv;
 
-		writer.end();
+	for (auto& arg : args)
+		argv.push_back(arg.c_str());
 
-		if (!images.empty()) {
-			writer.key("images");
-			writer.beginArray();
+	auto opt = parseArguments((unsigned int) argv.size(), argv.data());
 
-			for (unsigned int i = 0; i < images.size(); ++i) {
-				writer.begin();
+	if (opt.m_serve)
+		throw std::runtime_error("requests can't start a server");
 
-				if (!images[i].empty() && (!opt.m_trim || imageBounds[i].m_w != 0 || imageBounds[i].m_h != 0)) {
-					writer.key("texture");
-					writer.writeUint(imageRects[i].m_bin);
+	if (opt.m_incremental)
+		throw std::runtime_error("requests can't be incremental (the server keeps its own caches)");
 
-					writer.key("name");
-					writer.writeString(imageNames[i]);
+	checkInputs(opt);
 
-					if (opt.m_trim && (imageBounds[i].m_x != 0 || imageBounds[i].m_y != 0 ||
-						imageBounds[i].m_w != images[i].width() || imageBounds[i].m_h != images[i].height())) {
+	AtlasBuilder builder(opt, pool);
 
-						writer.key("offsetX");
-						writer.writeUint(imageBounds[i].m_x);
+	try {
+		for (auto& file : opt.m_files)
+			cache.addImage(builder, stripExtension(stripBase(file)), file);
 
-						writer.key("offsetY");
-						writer.writeUint(imageBounds[i].m_y);
+	#ifndef DISABLE_FREETYPE
+		for (auto& font : opt.m_fonts)
+			cache.addFont(builder, font);
+	#endif
 
-						writer.key("realWidth");
-						writer.writeUint(images[i].width());
+		unsigned int numSaved;
+		writeAtlas(opt, builder, nullptr, numSaved);
+	}
+	catch (...) {
+		cache.abort();
+		throw;
+	}
 
-						writer.key("realHeight");
-						writer.writeUint(images[i].height());
-					}
+	auto stats = cache.commit(builder);
+	auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
 
-					writer.key("x");
-					writer.writeUint(imageRects[i].m_x);
+	std::stringstream ss;
+	ss << "ok, reused images: " << stats.m_reusedImages << "/" << stats.m_images << ", fonts: " << stats.m_reusedFonts << "/" << stats.m_fonts
+		<< ", time: " << time << " ms";
 
-					writer.key("y");
-					writer.writeUint(imageRects[i].m_y);
+	return ss.str();
+}
 
-					writer.key("width");
-					writer.writeUint(opt.m_trim ? imageBounds[i].m_w : images[i].width());
+// Reads one request per line from stdin until it's closed, every request is answered with a single line
+static void serve(const Options& opt) {
+	ThreadPool pool(opt.m_threads);
+	BuildCache cache;
+	std::string line;
 
-					writer.key("height");
-					writer.writeUint(opt.m_trim ? imageBounds[i].m_h : images[i].height());
+	while (std::getline(std::cin, line)) {
+		auto args = splitArguments(line);
 
-					if (!opt.m_noFlip) {
-						writer.key("flipped");
-						writer.writeBool(imageRects[i].m_flipped);
-					}
-				}
-				else {
-					writer.key("name");
-					writer.writeString(imageNames[i]);
+		if (args.empty())
+			continue;
 
-					writer.key("realWidth");
-					writer.writeUint(images[i].width());
+		try {
+			std::cout << handleRequest(args, pool, cache) << std::endl;
+		}
+		catch (std::exception& ex) {
+			std::cout << "error: " << ex.what() << std::endl;
+		}
+	}
+}
 
-					writer.key("realHeight");
-					writer.writeUint(images[i].height());
-				}
+int main(int argc, const char** argv) {
+	try {
+		auto opt = parseArguments((unsigned int) argc - 1, argv + 1);
 
-				writer.end();
-			}
+		if (opt.m_help) {
+			std::cout << helpString << std::endl;
+			return 0;
+		}
 
-			writer.end();
+		if (opt.m_version) {
+			std::cout << versionString << std::endl;
+			return 0;
 		}
 
-	#ifndef DISABLE_FREETYPE
-		if (!fonts.empty()) {
-			writer.key("fonts");
-			writer.beginArray();
+		if (opt.m_serve) {
+			serve(opt);
+			return 0;
+		}
 
-			for (unsigned int i = 0; i < fonts.size(); ++i) {
-				writer.begin();
+		checkInputs(opt);
 
-				writer.key("name");
-				writer.writeString(opt.m_fonts[i].m_name);
+		ThreadPool pool(opt.m_threads);
+		AtlasBuilder builder(opt, pool);
 
-				writer.key("size");
-				writer.writeUint(opt.m_fonts[i].m_size);
+		// Incremental builds reuse the build which is recorded next to the metadata, as long as its textures exist
+		auto manifestFile = stripExtension(opt.m_output) + ".manifest";
+		BuildManifest previous;
+		BuildManifest manifest;
+		manifest.m_options = hashOptions(opt);
 
-				if (!fonts[i].m_glyphs.empty()) {
-					writer.key("glyphs");
-					writer.beginArray();
+		auto hasPrevious = opt.m_incremental && loadManifest(manifestFile, previous) && previous.m_options == manifest.m_options;
 
-					for (unsigned int j = 0; j < fonts[i].m_glyphs.size(); ++j) {
-						writer.begin();
-						
-						if (!fonts[i].m_glyphs[j].m_img.empty()) {
-							writer.key("texture");
-							writer.writeUint(fontRects[i][j].m_bin);
+		for (unsigned int i = 0; hasPrevious && i < previous.m_layout.m_textureSizes.size(); ++i) {
+			unsigned long long size, time;
+			hasPrevious = getFileInfo(textureFile(i), size, time);
+		}
 
-							writer.key("code");
-							writer.writeUint(fonts[i].m_glyphs[j].m_ind);
+		// The manifest is removed first, so textures which are only partly written are never reused
+		if (opt.m_incremental)
+			std::remove(manifestFile.c_str());
 
-							writer.key("x");
-							writer.writeUint(fontRects[i][j].m_x);
+		// Load images, only the pixels which fit into the memory budget are kept. Unchanged images are only loaded if needed.
+		for (unsigned int i = 0; i < opt.m_files.size(); ++i) {
+			auto& file = opt.m_files[i];
+			auto name = stripExtension(stripBase(file));
 
-							writer.key("y");
-							writer.writeUint(fontRects[i][j].m_y);
+			if (!opt.m_incremental) {
+				builder.addImageFile(name, file);
+				continue;
+			}
 
-							writer.key("width");
-							writer.writeUint(fonts[i].m_glyphs[j].m_img.width());
+			auto prev = hasPrevious && i < previous.m_images.size() && previous.m_images[i].m_file == file ? &previous.m_images[i] : nullptr;
 
-							writer.key("height");
-							writer.writeUint(fonts[i].m_glyphs[j].m_img.height());
+			manifest.m_images.emplace_back();
+			manifest.m_images.back().m_file = file;
 
-							if (!opt.m_noFlip) {
-								writer.key("flipped");
-								writer.writeBool(fontRects[i][j].m_flipped);
-							}
+			if (!updateManifestFile(manifest.m_images.back(), prev))
+				throw std::runtime_error(combine("file doesn't exist (\"", file, "\")"));
 
-							writer.key("advX");
-							writer.writeDouble(fonts[i].m_glyphs[j].advX);
+			if (prev && prev->m_hash == manifest.m_images.back().m_hash)
+				builder.addUnchangedImageFile(name, file, prev->m_width, prev->m_height, prev->m_bounds, prev->m_pixelHash);
+			else
+				builder.addImageFile(name, file);
+		}
 
-							writer.key("advY");
-							writer.writeDouble(fonts[i].m_glyphs[j].advY);
+	#ifndef DISABLE_FREETYPE
+		for (unsigned int i = 0; i < opt.m_fonts.size(); ++i) {
+			auto& font = opt.m_fonts[i];
 
-							writer.key("transX");
-							writer.writeInt(fonts[i].m_glyphs[j].transX);
+			if (!opt.m_incremental) {
+				builder.addFont(font);
+				continue;
+			}
 
-							writer.key("transY");
-							writer.writeInt(fonts[i].m_glyphs[j].transY);
-						}
-						else {
-							writer.key("code");
-							writer.writeUint(fonts[i].m_glyphs[j].m_ind);
+			auto prev = hasPrevious && i < previous.m_fonts.size() && previous.m_fonts[i].m_file == font.m_file ? &previous.m_fonts[i] : nullptr;
 
-							writer.key("advX");
-							writer.writeDouble(fonts[i].m_glyphs[j].advX);
+			manifest.m_fonts.emplace_back();
+			manifest.m_fonts.back().m_file = font.m_file;
 
-							writer.key("advY");
-							writer.writeDouble(fonts[i].m_glyphs[j].advY);
-						}
+			if (!updateManifestFile(manifest.m_fonts.back(), prev))
+				throw std::runtime_error(combine("file doesn't exist (\"", font.m_file, "\")"));
 
-						writer.end();
-					}
+			if (prev && prev->m_hash == manifest.m_fonts.back().m_hash)
+				builder.addUnchangedFont(font);
+			else
+				builder.addFont(font);
+		}
+	#endif
 
-					writer.end();
-				}
+		unsigned int numSaved;
+		auto atlas = writeAtlas(opt, builder, hasPrevious ? &previous.m_layout : nullptr, numSaved);
 
-				writer.end();
+		if (opt.m_incremental) {
+			for (unsigned int i = 0; i < manifest.m_images.size(); ++i) {
+				manifest.m_images[i].m_width = atlas.m_images[i].m_realWidth;
+				manifest.m_images[i].m_height = atlas.m_images[i].m_realHeight;
+				manifest.m_images[i].m_bounds = atlas.m_images[i].m_bounds;
+				manifest.m_images[i].m_pixelHash = builder.getImageHash(i);
 			}
 
-			writer.end();
+			manifest.m_layout = builder.getLayout();
+			saveManifest(manifest, manifestFile);
+
+			std::cout << (builder.isLayoutReused() ? "layout: reused" : "layout: packed") << ", saved textures: " << numSaved << "/" << atlas.m_textures.size() << std::endl;
 		}
-	#endif
 
-		writer.end();
-		f << '\n';
+		if (opt.m_autoSize) {
+			auto& res = builder.getAutoSize();
+			auto layers = opt.m_channels ? 4u : 1u;
+
+			std::cout << "size: " << res.m_width << "x" << res.m_height << ", textures: " << (res.m_numBins + layers - 1) / layers
+				<< ", occupancy: " << std::fixed << std::setprecision(1) << res.m_occupancy * 100 << "%" << std::endl;
+		}
 	}
 	catch (std::exception& ex) {
 		std::cout << "error: " << ex.what() << std::endl;
@@ -0,0 +1,246 @@
+// Disable warnings for fopen
+#ifdef _MSC_VER
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "Manifest.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "Dedup.hpp"
+#include "Platform.hpp"
+#include "Utils.hpp"
+
+static const unsigned int manifestVersion = 2;
+
+class ManifestWriter {
+public:
+	ManifestWriter(FILE* file): m_file(file) { }
+
+	template<typename T> void write(const T& value) {
+		fwrite(&value, sizeof(T), 1, m_file);
+	}
+
+	void writeString(const std::string& str) {
+		write((unsigned int) str.size());
+		fwrite(str.data(), 1, str.size(), m_file);
+	}
+
+	void writeRects(const std::vector<RectData>& rects) {
+		write((unsigned int) rects.size());
+
+		for (auto& rect : rects) {
+			unsigned int values[] = { rect.m_x, rect.m_y, rect.m_w, rect.m_h, rect.m_flipped ? 1u : 0u, rect.m_bin };
+			write(values);
+		}
+	}
+
+	void writeFile(const ManifestFile& file) {
+		writeString(file.m_file);
+		write(file.m_size);
+		write(file.m_time);
+		write(file.m_hash);
+	}
+
+private:
+	FILE* m_file;
+};
+
+// Every read fails once the end of the data is reached
+class ManifestReader {
+public:
+	ManifestReader(const unsigned char* data, std::size_t size): m_data(data), m_size(size) { }
+
+	inline bool isValid() const {
+		return m_valid;
+	}
+
+	template<typename T> T read() {
+		T value;
+		memset(&value, 0, sizeof(T));
+
+		if (m_valid && m_size - m_offset >= sizeof(T)) {
+			memcpy(&value, m_data + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+		}
+		else
+			m_valid = false;
+
+		return value;
+	}
+
+	// Counts are checked against the remaining size, so invalid files can't allocate too much memory
+	unsigned int readCount(std::size_t recordSize) {
+		auto count = read<unsigned int>();
+
+		if (count > (m_size - m_offset) / recordSize) {
+			m_valid = false;
+			return 0;
+		}
+
+		return count;
+	}
+
+	std::string readString() {
+		auto size = readCount(1);
+		std::string str((const char*) m_data + m_offset, size);
+		m_offset += size;
+
+		return str;
+	}
+
+	std::vector<RectData> readRects() {
+		std::vector<RectData> rects(readCount(6 * sizeof(unsigned int)));
+
+		for (auto& rect : rects) {
+			auto values = read<std::array<unsigned int, 6>>();
+			rect = { values[0], values[1], values[2], values[3], values[4] != 0, values[5] };
+		}
+
+		return rects;
+	}
+
+	void readFile(ManifestFile& file) {
+		file.m_file = readString();
+		file.m_size = read<unsigned long long>();
+		file.m_time = read<unsigned long long>();
+		file.m_hash = read<unsigned long long>();
+	}
+
+private:
+	const unsigned char* m_data;
+	std::size_t m_size;
+	std::size_t m_offset = 0;
+	bool m_valid = true;
+};
+
+bool loadManifest(const std::string& file, BuildManifest& manifest) {
+	MappedFile map(file);
+	ManifestReader reader(map.data(), map.size());
+
+	auto magic = reader.read<std::array<char, 4>>();
+
+	if (!reader.isValid() || memcmp(magic.data(), "MKBM", 4) != 0 || reader.read<unsigned int>() != manifestVersion)
+		return false;
+
+	manifest = BuildManifest();
+	manifest.m_options = reader.read<unsigned long long>();
+
+	manifest.m_images.resize(reader.readCount(36 + sizeof(Rectangle) + 2 * sizeof(unsigned int)));
+
+	for (auto& image : manifest.m_images) {
+		reader.readFile(image);
+		image.m_width = reader.read<unsigned int>();
+		image.m_height = reader.read<unsigned int>();
+		image.m_bounds = reader.read<Rectangle>();
+		image.m_pixelHash = reader.read<unsigned long long>();
+	}
+
+	manifest.m_fonts.resize(reader.readCount(28));
+
+	for (auto& font : manifest.m_fonts)
+		reader.readFile(font);
+
+	auto& layout = manifest.m_layout;
+	layout.m_width = reader.read<unsigned int>();
+	layout.m_height = reader.read<unsigned int>();
+	layout.m_numBins = reader.read<unsigned int>();
+	layout.m_autoSize.m_width = reader.read<unsigned int>();
+	layout.m_autoSize.m_height = reader.read<unsigned int>();
+	layout.m_autoSize.m_numBins = reader.read<unsigned int>();
+	layout.m_autoSize.m_occupancy = reader.read<double>();
+
+	layout.m_images.resize(reader.readCount(sizeof(unsigned int)));
+
+	for (auto& rects : layout.m_images)
+		rects = reader.readRects();
+
+	layout.m_fonts.resize(reader.readCount(sizeof(unsigned int)));
+
+	for (auto& rects : layout.m_fonts)
+		rects = reader.readRects();
+
+	auto numTextures = reader.readCount(sizeof(Rectangle) + sizeof(unsigned long long));
+
+	for (unsigned int i = 0; i < numTextures; ++i) {
+		layout.m_textureSizes.push_back(reader.read<Rectangle>());
+		layout.m_textureHashes.push_back(reader.read<unsigned long long>());
+	}
+
+	return reader.isValid();
+}
+
+void saveManifest(const BuildManifest& manifest, const std::string& file) {
+	auto f = finalize(fopen(file.c_str(), "wb"), fclose);
+
+	if (!f)
+		throw std::runtime_error(combine("failed to open file (\"", file, "\")"));
+
+	ManifestWriter writer(f.get());
+
+	writer.write(std::array<char, 4>{ { 'M', 'K', 'B', 'M' } });
+	writer.write(manifestVersion);
+	writer.write(manifest.m_options);
+
+	writer.write((unsigned int) manifest.m_images.size());
+
+	for (auto& image : manifest.m_images) {
+		writer.writeFile(image);
+		writer.write(image.m_width);
+		writer.write(image.m_height);
+		writer.write(image.m_bounds);
+		writer.write(image.m_pixelHash);
+	}
+
+	writer.write((unsigned int) manifest.m_fonts.size());
+
+	for (auto& font : manifest.m_fonts)
+		writer.writeFile(font);
+
+	auto& layout = manifest.m_layout;
+	writer.write(layout.m_width);
+	writer.write(layout.m_height);
+	writer.write(layout.m_numBins);
+	writer.write(layout.m_autoSize.m_width);
+	writer.write(layout.m_autoSize.m_height);
+	writer.write(layout.m_autoSize.m_numBins);
+	writer.write(layout.m_autoSize.m_occupancy);
+
+	writer.write((unsigned int) layout.m_images.size());
+
+	for (auto& rects : layout.m_images)
+		writer.writeRects(rects);
+
+	writer.write((unsigned int) layout.m_fonts.size());
+
+	for (auto& rects : layout.m_fonts)
+		writer.writeRects(rects);
+
+	writer.write((unsigned int) layout.m_textureSizes.size());
+
+	for (unsigned int i = 0; i < layout.m_textureSizes.size(); ++i) {
+		writer.write(layout.m_textureSizes[i]);
+		writer.write(layout.m_textureHashes[i]);
+	}
+
+	if (ferror(f.get()))
+		throw std::runtime_error(combine("failed to write file (\"", file, "\")"));
+}
+
+bool updateManifestFile(ManifestFile& file, const ManifestFile* previous) {
+	if (!getFileInfo(file.m_file, file.m_size, file.m_time))
+		return false;
+
+	if (previous && previous->m_file == file.m_file && previous->m_size == file.m_size && previous->m_time == file.m_time) {
+		file.m_hash = previous->m_hash;
+		return true;
+	}
+
+	MappedFile map(file.m_file);
+	file.m_hash = hashBytes(map.data(), map.size());
+
+	return true;
+}
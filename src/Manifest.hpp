@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AtlasBuilder.hpp"
+
+// Input file of a build, files with the same size and time aren't read again to compare their hash
+struct ManifestFile {
+	std::string m_file;
+	unsigned long long m_size = 0;
+	unsigned long long m_time = 0;
+	unsigned long long m_hash = 0;
+};
+
+struct ManifestImage : ManifestFile {
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+	Rectangle m_bounds = { 0, 0, 0, 0 };
+	unsigned long long m_pixelHash = 0;
+};
+
+// Record of a build, which is read by the next incremental build. The layout is only reused if the options
+// (hashed by the caller) are the same.
+//
+// Layout of the file (native byte order):
+//   char magic[4] = "MKBM", uint32 version, uint64 options
+//   inputs, layout and textures (counts followed by their records, strings are prefixed with their length)
+struct BuildManifest {
+	unsigned long long m_options = 0;
+	std::vector<ManifestImage> m_images;
+	std::vector<ManifestFile> m_fonts;
+	AtlasLayout m_layout;
+};
+
+// Returns false if the file doesn't exist or is invalid
+bool loadManifest(const std::string& file, BuildManifest& manifest);
+void saveManifest(const BuildManifest& manifest, const std::string& file);
+
+// Fills in size, time and hash of the file. The hash of the previous record is kept if size and time didn't change.
+// Returns false if the file doesn't exist.
+bool updateManifestFile(ManifestFile& file, const ManifestFile* previous);
@@ -13,8 +13,12 @@ MaxRects::~MaxRects() {
 	clear();
 }
 
+bool MaxRects::canFit(unsigned int w, unsigned int h) const {
+	return fits(w, h, m_config.m_width, m_config.m_height, m_config.m_canFlip);
+}
+
 void MaxRects::add(RectData* data, unsigned int w, unsigned int h) {
-	if (!fits(w, h, m_config.m_width, m_config.m_height, m_config.m_canFlip))
+	if (!canFit(w, h))
 		throw std::runtime_error("rectangle doesn't fit");
 
 	*data = { 0, 0, w, h, false, 0 };
@@ -34,6 +34,7 @@ public:
 		return m_bins.size();
 	}
 
+	bool canFit(unsigned int w, unsigned int h) const;
 	void add(RectData* data, unsigned int w, unsigned int h);
 	void clear();
 	bool pack();
@@ -0,0 +1,314 @@
+#include "MultiDistantField.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Utils.hpp"
+
+// Based on the technique of Viktor Chlumsky's "Shape Decomposition for Multi-channel Distance Fields"
+
+static inline Vector2 operator-(Vector2 a, Vector2 b) {
+	return { a.m_x - b.m_x, a.m_y - b.m_y };
+}
+
+static inline double dot(Vector2 a, Vector2 b) {
+	return a.m_x * b.m_x + a.m_y * b.m_y;
+}
+
+static inline double cross(Vector2 a, Vector2 b) {
+	return a.m_x * b.m_y - a.m_y * b.m_x;
+}
+
+static inline double length(Vector2 a) {
+	return std::sqrt(dot(a, a));
+}
+
+static inline Vector2 normalize(Vector2 a) {
+	auto len = length(a);
+	return len == 0 ? Vector2 { 0, 1 } : Vector2 { a.m_x / len, a.m_y / len };
+}
+
+static inline double nonZeroSign(double val) {
+	return val > 0 ? 1.0 : -1.0;
+}
+
+struct SignedDistance {
+	double m_distance;
+	double m_dot;
+
+	bool operator<(const SignedDistance& other) const {
+		auto a = std::fabs(m_distance), b = std::fabs(other.m_distance);
+		return a < b || (a == b && m_dot < other.m_dot);
+	}
+};
+
+// Direction at the start and end of an edge
+static Vector2 startDirection(const Edge& edge) {
+	for (unsigned int i = 1; i < edge.m_points.size(); ++i)
+		if (edge.m_points[i].m_x != edge.m_points[0].m_x || edge.m_points[i].m_y != edge.m_points[0].m_y)
+			return edge.m_points[i] - edge.m_points[0];
+
+	return { 0, 0 };
+}
+
+static Vector2 endDirection(const Edge& edge) {
+	auto& last = edge.m_points.back();
+
+	for (auto i = (int) edge.m_points.size() - 2; i >= 0; --i)
+		if (edge.m_points[i].m_x != last.m_x || edge.m_points[i].m_y != last.m_y)
+			return last - edge.m_points[i];
+
+	return { 0, 0 };
+}
+
+static SignedDistance segmentDistance(Vector2 a, Vector2 b, Vector2 origin, double& param) {
+	auto aq = origin - a;
+	auto ab = b - a;
+
+	param = dot(aq, ab) / dot(ab, ab);
+
+	auto eq = (param > 0.5 ? b : a) - origin;
+	auto endpointDistance = length(eq);
+
+	if (param > 0 && param < 1) {
+		auto orthoDistance = cross(aq, ab) / length(ab);
+
+		if (std::fabs(orthoDistance) < endpointDistance)
+			return { orthoDistance, 0 };
+	}
+
+	return { nonZeroSign(cross(aq, ab)) * endpointDistance, std::fabs(dot(normalize(ab), normalize(eq))) };
+}
+
+// Distance to the nearest segment of the polyline, segment is the index of that segment
+static SignedDistance edgeDistance(const Edge& edge, Vector2 origin, unsigned int& segment, double& param) {
+	SignedDistance best { 1e240, 1 };
+
+	for (unsigned int i = 0; i + 1 < edge.m_points.size(); ++i) {
+		auto& a = edge.m_points[i];
+		auto& b = edge.m_points[i + 1];
+
+		if (a.m_x == b.m_x && a.m_y == b.m_y)
+			continue;
+
+		double p;
+		auto dist = segmentDistance(a, b, origin, p);
+
+		if (dist < best) {
+			best = dist;
+			segment = i;
+			param = p;
+		}
+	}
+
+	return best;
+}
+
+// Extends the ends of an edge, so the distance doesn't round off beyond its endpoints
+static void toPseudoDistance(SignedDistance& dist, const Edge& edge, Vector2 origin, unsigned int segment, double param) {
+	if (param < 0 && segment == 0) {
+		auto dir = normalize(startDirection(edge));
+		auto aq = origin - edge.m_points.front();
+
+		if (dot(aq, dir) < 0) {
+			auto pseudo = cross(aq, dir);
+
+			if (std::fabs(pseudo) <= std::fabs(dist.m_distance))
+				dist = { pseudo, 0 };
+		}
+	}
+	else if (param > 1 && segment + 2 == edge.m_points.size()) {
+		auto dir = normalize(endDirection(edge));
+		auto bq = origin - edge.m_points.back();
+
+		if (dot(bq, dir) > 0) {
+			auto pseudo = cross(bq, dir);
+
+			if (std::fabs(pseudo) <= std::fabs(dist.m_distance))
+				dist = { pseudo, 0 };
+		}
+	}
+}
+
+static bool isCorner(Vector2 a, Vector2 b) {
+	// Sine of the angle above which a joint is a corner
+	const double crossThreshold = std::sin(3.0);
+
+	a = normalize(a);
+	b = normalize(b);
+
+	return dot(a, b) <= 0 || std::fabs(cross(a, b)) > crossThreshold;
+}
+
+static void switchColor(unsigned int& color, unsigned int banned = 0) {
+	auto combined = color & banned;
+
+	if (combined == Edge::Red || combined == Edge::Green || combined == Edge::Blue) {
+		color = combined ^ Edge::White;
+		return;
+	}
+
+	if (color == 0 || color == Edge::White) {
+		color = Edge::Cyan;
+		return;
+	}
+
+	auto shifted = color << 1;
+	color = (shifted | shifted >> 3) & Edge::White;
+}
+
+// Splits an edge into three parts
+static std::vector<Edge> splitInThirds(const Edge& edge) {
+	std::vector<Vector2> points;
+
+	// Make sure the polyline has at least three segments
+	for (unsigned int i = 0; i + 1 < edge.m_points.size(); ++i) {
+		auto a = edge.m_points[i], b = edge.m_points[i + 1];
+
+		for (unsigned int j = 0; j < 3; ++j)
+			points.push_back({ a.m_x + (b.m_x - a.m_x) * j / 3, a.m_y + (b.m_y - a.m_y) * j / 3 });
+	}
+
+	points.push_back(edge.m_points.back());
+
+	auto n = points.size() - 1;
+	std::vector<Edge> parts(3);
+
+	for (unsigned int i = 0; i < 3; ++i)
+		parts[i].m_points.assign(points.begin() + n * i / 3, points.begin() + n * (i + 1) / 3 + 1);
+
+	return parts;
+}
+
+void colorEdges(Shape& shape) {
+	for (auto& contour : shape.m_contours) {
+		auto& edges = contour.m_edges;
+
+		if (edges.empty())
+			continue;
+
+		std::vector<unsigned int> corners;
+
+		for (unsigned int i = 0; i < edges.size(); ++i)
+			if (isCorner(endDirection(edges[i == 0 ? edges.size() - 1 : i - 1]), startDirection(edges[i])))
+				corners.push_back(i);
+
+		if (corners.empty()) {
+			// Smooth contour
+			for (auto& edge : edges)
+				edge.m_color = Edge::White;
+		}
+		else if (corners.size() == 1) {
+			// Teardrop, three colors are spread along the contour
+			unsigned int colors[3] = { Edge::White, Edge::White, Edge::White };
+			switchColor(colors[0]);
+			colors[2] = colors[0];
+			switchColor(colors[2]);
+
+			std::rotate(edges.begin(), edges.begin() + corners[0], edges.end());
+
+			if (edges.size() >= 3) {
+				auto m = edges.size();
+
+				for (unsigned int i = 0; i < m; ++i)
+					edges[i].m_color = colors[1 + (int) (3 + 2.875 * i / (m - 1) - 1.4375 + 0.5) - 3];
+			}
+			else {
+				std::vector<Edge> parts;
+
+				for (auto& edge : edges) {
+					auto split = splitInThirds(edge);
+					parts.insert(parts.end(), split.begin(), split.end());
+				}
+
+				if (parts.size() == 3) {
+					parts[0].m_color = colors[0];
+					parts[1].m_color = colors[1];
+					parts[2].m_color = colors[2];
+				}
+				else {
+					parts[0].m_color = parts[1].m_color = colors[0];
+					parts[2].m_color = parts[3].m_color = colors[1];
+					parts[4].m_color = parts[5].m_color = colors[2];
+				}
+
+				edges = std::move(parts);
+			}
+		}
+		else {
+			// Switch color at every corner
+			unsigned int spline = 0;
+			unsigned int color = Edge::White;
+
+			switchColor(color);
+			auto initialColor = color;
+
+			for (unsigned int i = 0; i < edges.size(); ++i) {
+				auto index = (corners[0] + i) % edges.size();
+
+				if (spline + 1 < corners.size() && corners[spline + 1] == index) {
+					++spline;
+					switchColor(color, spline == corners.size() - 1 ? initialColor : 0);
+				}
+
+				edges[index].m_color = color;
+			}
+		}
+	}
+}
+
+static unsigned char distanceToChannel(double dist) {
+	auto v = std::max(std::min(0.5 + 0.5 * dist, 1.0), 0.0);
+	return (unsigned char) (v * 0xFF);
+}
+
+Image multiDistantFieldFromShape(const Shape& shape, double left, double top, unsigned int width, unsigned int height, double range) {
+	Image img(width, height);
+
+	struct Nearest {
+		SignedDistance m_distance;
+		const Edge* m_edge;
+		unsigned int m_segment;
+		double m_param;
+	};
+
+	for (unsigned int j = 0; j < height; ++j) {
+		for (unsigned int i = 0; i < width; ++i) {
+			Vector2 origin { left + i + 0.5, top - j - 0.5 };
+
+			Nearest channels[3];
+
+			for (auto& channel : channels)
+				channel = { { 1e240, 1 }, nullptr, 0, 0 };
+
+			for (auto& contour : shape.m_contours) {
+				for (auto& edge : contour.m_edges) {
+					unsigned int segment = 0;
+					double param = 0;
+
+					auto dist = edgeDistance(edge, origin, segment, param);
+
+					for (unsigned int c = 0; c < 3; ++c)
+						if ((edge.m_color & (1 << c)) && dist < channels[c].m_distance)
+							channels[c] = { dist, &edge, segment, param };
+				}
+			}
+
+			unsigned char values[3];
+
+			for (unsigned int c = 0; c < 3; ++c) {
+				auto& nearest = channels[c];
+
+				if (nearest.m_edge)
+					toPseudoDistance(nearest.m_distance, *nearest.m_edge, origin, nearest.m_segment, nearest.m_param);
+
+				auto dist = nearest.m_distance.m_distance / range;
+				values[c] = distanceToChannel(shape.m_inverted ? -dist : dist);
+			}
+
+			img.at(i, j) = makeRBGA(values[0], values[1], values[2], 0xFF);
+		}
+	}
+
+	return img;
+}
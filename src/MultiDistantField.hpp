@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "Image.hpp"
+
+struct Vector2 {
+	double m_x;
+	double m_y;
+};
+
+// Edge of a contour. Curves are flattened into a polyline.
+struct Edge {
+	enum {
+		Red = 1,
+		Green = 2,
+		Blue = 4,
+		Yellow = Red | Green,
+		Magenta = Red | Blue,
+		Cyan = Green | Blue,
+		White = Red | Green | Blue
+	};
+
+	std::vector<Vector2> m_points;
+	unsigned int m_color = White;
+};
+
+struct Contour {
+	std::vector<Edge> m_edges;
+};
+
+// Outline of a glyph, the y axis points upwards
+struct Shape {
+	std::vector<Contour> m_contours;
+	bool m_inverted = false; // Set if filled contours run counter clockwise
+};
+
+// Assigns colors to the edges, so corners are kept sharp
+void colorEdges(Shape& shape);
+
+// Generates a multi channel signed distant field of the area [left, left + width] x [top - height, top].
+// The distances are normalized to range.
+Image multiDistantFieldFromShape(const Shape& shape, double left, double top, unsigned int width, unsigned int height, double range);
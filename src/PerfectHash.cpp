@@ -0,0 +1,189 @@
+#include "PerfectHash.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+// Average number of keys per bucket
+static const unsigned int keysPerBucket = 4;
+
+static inline unsigned long long mix(unsigned long long value) {
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDull;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+unsigned long long perfectHashKey(const std::string& str, unsigned int seed) {
+	auto hash = 14695981039346656037ull ^ seed;
+
+	for (auto chr : str)
+		hash = (hash ^ (unsigned char) chr) * 1099511628211ull;
+
+	return hash;
+}
+
+unsigned int perfectHashBucket(unsigned long long key, unsigned int numBuckets) {
+	return (unsigned int) (mix(key) % numBuckets);
+}
+
+unsigned int perfectHashSlot(unsigned long long key, unsigned int displacement, unsigned int numSlots) {
+	if (displacement & perfectHashDirect)
+		return displacement & ~perfectHashDirect;
+
+	return (unsigned int) (mix(key + displacement * 0x9E3779B97F4A7C15ull) % numSlots);
+}
+
+// Places the distinct hashes into the slots, unique contains the index of the key of every hash
+static void placeKeys(const std::vector<unsigned long long>& hashes, const std::vector<unsigned int>& unique, PerfectHash& res) {
+	auto numSlots = (unsigned int) hashes.size();
+	auto numBuckets = (numSlots + keysPerBucket - 1) / keysPerBucket;
+
+	// Keys are sorted into buckets
+	std::vector<unsigned int> bucketOffsets(numBuckets + 1, 0);
+	std::vector<unsigned int> bucketKeys(numSlots);
+
+	for (auto hash : hashes)
+		++bucketOffsets[perfectHashBucket(hash, numBuckets) + 1];
+
+	for (unsigned int i = 0; i < numBuckets; ++i)
+		bucketOffsets[i + 1] += bucketOffsets[i];
+
+	{
+		auto next = bucketOffsets;
+
+		for (unsigned int i = 0; i < numSlots; ++i)
+			bucketKeys[next[perfectHashBucket(hashes[i], numBuckets)]++] = i;
+	}
+
+	// Large buckets are placed first, while most slots are free
+	std::vector<unsigned int> order(numBuckets);
+
+	for (unsigned int i = 0; i < numBuckets; ++i)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&bucketOffsets](unsigned int a, unsigned int b) {
+		return bucketOffsets[a + 1] - bucketOffsets[a] > bucketOffsets[b + 1] - bucketOffsets[b];
+	});
+
+	res.m_displacements.assign(numBuckets, 0);
+	res.m_slots.assign(numSlots, 0);
+
+	// Slots of a bucket are taken while they are tried, so its keys don't collide with each other
+	std::vector<unsigned char> taken(numSlots, 0);
+	std::vector<unsigned int> slots;
+
+	unsigned int nextFree = 0;
+
+	for (unsigned int i = 0; i < numBuckets; ++i) {
+		auto bucket = order[i];
+		auto beg = bucketOffsets[bucket];
+		auto end = bucketOffsets[bucket + 1];
+
+		if (beg == end)
+			break;
+
+		// Single keys are placed into the next free slot directly, searching a displacement gets slow when few slots are left
+		if (end - beg == 1) {
+			while (taken[nextFree] != 0)
+				++nextFree;
+
+			taken[nextFree] = 1;
+			res.m_displacements[bucket] = perfectHashDirect | nextFree;
+			res.m_slots[nextFree] = unique[bucketKeys[beg]];
+			continue;
+		}
+
+		for (unsigned int displacement = 0;; ++displacement) {
+			if (displacement == perfectHashDirect)
+				throw std::runtime_error("failed to build perfect hash");
+
+			slots.clear();
+
+			for (auto j = beg; j < end; ++j) {
+				auto slot = perfectHashSlot(hashes[bucketKeys[j]], displacement, numSlots);
+
+				if (taken[slot] != 0)
+					break;
+
+				taken[slot] = 1;
+				slots.push_back(slot);
+			}
+
+			if (slots.size() == end - beg) {
+				res.m_displacements[bucket] = displacement;
+				break;
+			}
+
+			for (auto slot : slots)
+				taken[slot] = 0;
+		}
+
+		for (unsigned int j = 0; j < slots.size(); ++j)
+			res.m_slots[slots[j]] = unique[bucketKeys[beg + j]];
+	}
+}
+
+PerfectHash buildPerfectHash(const std::vector<std::string>& keys) {
+	PerfectHash res;
+
+	if (keys.empty())
+		return res;
+
+	// Keys are sorted by hash to find equal keys, which can't be separated (lookups find the first one).
+	// Different keys with the same hash are very unlikely, another seed is tried for them.
+	std::vector<std::pair<unsigned long long, unsigned int>> sorted(keys.size());
+	std::vector<unsigned int> unique;
+	std::vector<unsigned long long> hashes;
+
+	for (;; ++res.m_seed) {
+		for (unsigned int i = 0; i < keys.size(); ++i)
+			sorted[i] = { perfectHashKey(keys[i], res.m_seed), i };
+
+		std::sort(sorted.begin(), sorted.end());
+
+		unique.clear();
+		hashes.clear();
+
+		bool collision = false;
+
+		for (unsigned int i = 0; i < sorted.size() && !collision; ++i) {
+			if (i == 0 || sorted[i].first != hashes.back()) {
+				unique.push_back(sorted[i].second);
+				hashes.push_back(sorted[i].first);
+			}
+			else if (keys[sorted[i].second] != keys[unique.back()])
+				collision = true;
+		}
+
+		if (!collision)
+			break;
+	}
+
+	sorted = std::vector<std::pair<unsigned long long, unsigned int>>();
+	placeKeys(hashes, unique, res);
+
+	return res;
+}
+
+PerfectHash buildPerfectHash(const std::vector<unsigned long long>& keys) {
+	PerfectHash res;
+
+	if (keys.empty())
+		return res;
+
+	std::vector<unsigned int> indices(keys.size());
+
+	for (unsigned int i = 0; i < keys.size(); ++i)
+		indices[i] = i;
+
+	placeKeys(keys, indices, res);
+
+	return res;
+}
+
+unsigned long long perfectHashKey(unsigned int first, unsigned int second) {
+	return (unsigned long long) first << 32 | second;
+}
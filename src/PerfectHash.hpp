@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Minimal perfect hash of strings or character pairs (hash and displace). The lookup is repeated by the readers
+// of the metadata (include/mkatlas.h and generated headers), so it must not change without a new format version:
+//   key    = FNV-1a of the string, starting with offset basis ^ seed
+//   bucket = mix(key) % numBuckets
+//   slot   = mix(key + displacement[bucket] * 0x9E3779B97F4A7C15) % numSlots
+// where mix is the finalizer of MurmurHash3. Displacements with the highest bit set contain the slot instead
+// (used for buckets with a single key). Pairs of characters are distinct, their key is first << 32 | second.
+const unsigned int perfectHashDirect = 0x80000000;
+
+struct PerfectHash {
+	unsigned int m_seed = 0;
+	std::vector<unsigned int> m_displacements;
+
+	// Index of the key in every slot, only the first of equal keys is in the table
+	std::vector<unsigned int> m_slots;
+};
+
+PerfectHash buildPerfectHash(const std::vector<std::string>& keys);
+
+// The keys have to be distinct (e.g. keys of pairs), the seed is always zero
+PerfectHash buildPerfectHash(const std::vector<unsigned long long>& keys);
+
+unsigned long long perfectHashKey(const std::string& str, unsigned int seed);
+unsigned long long perfectHashKey(unsigned int first, unsigned int second);
+unsigned int perfectHashBucket(unsigned long long key, unsigned int numBuckets);
+unsigned int perfectHashSlot(unsigned long long key, unsigned int displacement, unsigned int numSlots);
@@ -82,6 +82,62 @@
 
 		return str.substr(0, dot);
 	}
+
+	bool getFileInfo(const std::string& file, unsigned long long& size, unsigned long long& time) {
+		std::wstring_convert<std::codecvt_utf8_utf16<CHAR16>, CHAR16> conv;
+		auto filew = conv.from_bytes(file.data());
+
+		WIN32_FILE_ATTRIBUTE_DATA data;
+
+		if (!GetFileAttributesEx((LPCWSTR) filew.c_str(), GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+			return false;
+
+		size = (unsigned long long) data.nFileSizeHigh << 32 | data.nFileSizeLow;
+		time = (unsigned long long) data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime;
+
+		return true;
+	}
+
+	MappedFile::MappedFile(const std::string& file) {
+		std::wstring_convert<std::codecvt_utf8_utf16<CHAR16>, CHAR16> conv;
+		auto filew = conv.from_bytes(file.data());
+
+		auto h = CreateFile((LPCWSTR) filew.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+			return;
+
+		m_file = h;
+
+		LARGE_INTEGER size;
+
+		// Empty files can't be mapped, files which fail to be mapped are treated as empty as well
+		if (!GetFileSizeEx(h, &size) || size.QuadPart == 0)
+			return;
+
+		m_mapping = CreateFileMapping(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (!m_mapping)
+			return;
+
+		m_data = (const unsigned char*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (!m_data)
+			return;
+
+		m_size = (std::size_t) size.QuadPart;
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_data)
+			UnmapViewOfFile(m_data);
+
+		if (m_mapping)
+			CloseHandle(m_mapping);
+
+		if (m_file)
+			CloseHandle(m_file);
+	}
 #else
 	#error Operating System is not supported!
 #endif
@@ -1,8 +1,36 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <string>
 
 std::vector<std::string> glob(const std::string& str);
 std::string stripBase(const std::string& str);
 std::string stripExtension(const std::string& str);
+
+// Size and time of the last modification of a file (in an unspecified unit), returns false if the file doesn't exist
+bool getFileInfo(const std::string& file, unsigned long long& size, unsigned long long& time);
+
+// Read only view of a whole file. The view is empty if the file doesn't exist (or is empty).
+class MappedFile {
+public:
+	MappedFile(const std::string& file);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline const unsigned char* data() const {
+		return m_data;
+	}
+
+	inline std::size_t size() const {
+		return m_size;
+	}
+
+private:
+	const unsigned char* m_data = nullptr;
+	std::size_t m_size = 0;
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+};
@@ -5,16 +5,16 @@
 #include <string>
 
 struct Range {
-	bool isInside(unsigned int value) {
+	bool isInside(unsigned int value) const {
 		return value >= m_beg && value <= m_end;
 	}
 
-	bool isIntersecting(Range r) {
+	bool isIntersecting(Range r) const {
 		return isInside(r.m_beg) || isInside(r.m_end) ||
 			r.isInside(m_beg) || r.isInside(m_end);
 	}
 
-	Range join(Range r) {
+	Range join(Range r) const {
 		assert(isIntersecting(r) && "can't join ranges");
 
 		return { std::min(m_beg, r.m_beg), std::max(m_end, r.m_end) };
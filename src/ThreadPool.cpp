@@ -0,0 +1,161 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+// Index of the queue owned by the current thread, threads outside of the pool don't own one
+static thread_local unsigned int ownQueue = ~0u;
+static thread_local const ThreadPool* ownPool = nullptr;
+
+ThreadPool::ThreadPool(unsigned int numThreads) {
+	if (numThreads == 0)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+		m_queues.emplace_back(new Queue());
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+		m_workers.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::push(unsigned int queue, Task task) {
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queue]->m_mutex);
+		m_queues[queue]->m_tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_queued;
+	}
+
+	m_wake.notify_one();
+}
+
+bool ThreadPool::pop(unsigned int queue, Task& task) {
+	std::lock_guard<std::mutex> lock(m_queues[queue]->m_mutex);
+
+	if (m_queues[queue]->m_tasks.empty())
+		return false;
+
+	// Own tasks are taken from the back, they are more likely to be in the cache
+	task = std::move(m_queues[queue]->m_tasks.back());
+	m_queues[queue]->m_tasks.pop_back();
+	--m_queued;
+
+	return true;
+}
+
+bool ThreadPool::steal(unsigned int queue, Task& task) {
+	for (unsigned int i = 1; i <= m_queues.size(); ++i) {
+		auto& other = *m_queues[(queue + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(other.m_mutex);
+
+		if (!other.m_tasks.empty()) {
+			task = std::move(other.m_tasks.front());
+			other.m_tasks.pop_front();
+			--m_queued;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ThreadPool::runOne(unsigned int queue, bool own) {
+	Task task;
+
+	if ((own && pop(queue, task)) || steal(queue, task)) {
+		task();
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::run(unsigned int index) {
+	ownQueue = index;
+	ownPool = this;
+
+	for (;;) {
+		if (runOne(index, true))
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wake.wait(lock, [this] { return m_stop || m_queued > 0; });
+
+		if (m_stop && m_queued == 0)
+			return;
+	}
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int)>& func) {
+	if (count == 0)
+		return;
+
+	if (count == 1) {
+		func(0);
+		return;
+	}
+
+	struct Batch {
+		std::atomic<unsigned int> m_remaining;
+		std::mutex m_mutex;
+		std::condition_variable m_done;
+		std::exception_ptr m_exception;
+	} batch;
+
+	batch.m_remaining = count;
+
+	auto queue = ownPool == this ? ownQueue : ~0u;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		push(queue == ~0u ? m_next++ % m_queues.size() : queue, [&batch, &func, i] {
+			try {
+				func(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(batch.m_mutex);
+
+				if (!batch.m_exception)
+					batch.m_exception = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(batch.m_mutex);
+
+			if (--batch.m_remaining == 0)
+				batch.m_done.notify_all();
+		});
+	}
+
+	// Help with the queued tasks until the batch is finished
+	auto helper = queue == ~0u ? m_next.load() % m_queues.size() : queue;
+
+	while (batch.m_remaining > 0) {
+		if (runOne(helper, queue != ~0u))
+			continue;
+
+		std::unique_lock<std::mutex> lock(batch.m_mutex);
+		batch.m_done.wait_for(lock, std::chrono::milliseconds(1), [&batch] { return batch.m_remaining == 0; });
+	}
+
+	// Make sure the last task released the batch
+	std::lock_guard<std::mutex> lock(batch.m_mutex);
+
+	if (batch.m_exception)
+		std::rethrow_exception(batch.m_exception);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool. Every worker has its own queue and steals from the others if it runs out of work.
+// Threads which wait for their tasks help executing queued tasks, so parallelFor can be nested.
+class ThreadPool {
+public:
+	// Zero uses one thread per hardware thread
+	explicit ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline unsigned int size() const {
+		return m_workers.size();
+	}
+
+	// Calls func for every index in [0, count) and waits until all calls are finished.
+	// The first exception thrown by func is rethrown.
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)>& func);
+
+private:
+	typedef std::function<void()> Task;
+
+	struct Queue {
+		std::mutex m_mutex;
+		std::deque<Task> m_tasks;
+	};
+
+	void run(unsigned int index);
+	void push(unsigned int queue, Task task);
+	bool pop(unsigned int queue, Task& task);
+	bool steal(unsigned int queue, Task& task);
+	bool runOne(unsigned int queue, bool own);
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::atomic<unsigned int> m_queued { 0 };
+	std::atomic<unsigned int> m_next { 0 };
+	bool m_stop = false;
+};
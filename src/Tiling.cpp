@@ -0,0 +1,33 @@
+#include "Tiling.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+static unsigned int getNumTiles(unsigned int size, unsigned int max, unsigned int overlap) {
+	if (size <= max)
+		return 1;
+
+	return (size - overlap + (max - overlap) - 1) / (max - overlap);
+}
+
+TileGrid splitIntoTiles(unsigned int w, unsigned int h, unsigned int maxW, unsigned int maxH, unsigned int overlap, bool canFlip) {
+	if ((w <= maxW && h <= maxH) || (canFlip && h <= maxW && w <= maxH))
+		return { 1, 1, { { 0, 0, w, h } } };
+
+	if (maxW <= overlap || maxH <= overlap)
+		throw std::runtime_error("textures are too small to split images into tiles");
+
+	TileGrid grid { getNumTiles(w, maxW, overlap), getNumTiles(h, maxH, overlap), { } };
+	grid.m_tiles.reserve(grid.m_columns * grid.m_rows);
+
+	for (unsigned int j = 0; j < grid.m_rows; ++j) {
+		auto y = j * (maxH - overlap);
+
+		for (unsigned int i = 0; i < grid.m_columns; ++i) {
+			auto x = i * (maxW - overlap);
+			grid.m_tiles.push_back({ x, y, std::min(maxW, w - x), std::min(maxH, h - y) });
+		}
+	}
+
+	return grid;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+#include "Rectangle.hpp"
+
+struct TileGrid {
+	unsigned int m_columns;
+	unsigned int m_rows;
+	std::vector<Rectangle> m_tiles; // Row major
+};
+
+// Splits an area which doesn't fit into maxW x maxH into tiles. Adjacent tiles overlap by the given amount.
+TileGrid splitIntoTiles(unsigned int w, unsigned int h, unsigned int maxW, unsigned int maxH, unsigned int overlap, bool canFlip);